@@ -0,0 +1,58 @@
+#include <algorithm>
+
+#include "PhaseBarrier.h"
+
+using namespace Enki;
+
+/**
+ * Tell the processor that we are in a spin loop.
+ */
+static inline void cpuRelax ()
+{
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+	__builtin_ia32_pause ();
+#endif
+}
+
+PhaseBarrier::
+PhaseBarrier (unsigned int participants, int maximumSpin):
+	participants (participants),
+	maximumSpin (std::max (0, maximumSpin)),
+	arrived (0),
+	generation (0),
+	sleepers (0)
+{
+}
+
+void PhaseBarrier::
+wait (int &spin)
+{
+	const unsigned int phase = this->generation.load (boost::memory_order_acquire);
+	if (this->arrived.fetch_add (1, boost::memory_order_acq_rel) + 1 == this->participants) {
+		// last thread: start the next phase and wake up sleeping threads
+		this->arrived.store (0, boost::memory_order_relaxed);
+		this->generation.fetch_add (1, boost::memory_order_seq_cst);
+		if (this->sleepers.load (boost::memory_order_seq_cst) > 0) {
+			boost::lock_guard<boost::mutex> lock (this->mutex);
+			this->wakeUp.notify_all ();
+		}
+		return ;
+	}
+	for (int i = 0; i < spin; i++) {
+		if (this->generation.load (boost::memory_order_acquire) != phase) {
+			spin = std::min (2 * spin, this->maximumSpin);
+			return ;
+		}
+		cpuRelax ();
+	}
+	if (this->maximumSpin > 0) {
+		spin = std::max (spin / 2, (int) PhaseBarrier::MINIMUM_SPIN);
+	}
+	boost::unique_lock<boost::mutex> lock (this->mutex);
+	// the last thread reads this counter after incrementing the generation
+	this->sleepers.fetch_add (1, boost::memory_order_seq_cst);
+	while (this->generation.load (boost::memory_order_seq_cst) == phase) {
+		this->wakeUp.wait (lock);
+	}
+	this->sleepers.fetch_sub (1, boost::memory_order_relaxed);
+}
@@ -0,0 +1,91 @@
+#ifndef __PHASE_BARRIER_H
+#define __PHASE_BARRIER_H
+
+#ifndef Q_MOC_RUN
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#endif
+
+namespace Enki
+{
+	/**
+	 * A reusable barrier for a fixed number of threads.  Each use of the
+	 * barrier is a phase, identified by a generation counter.  The last
+	 * thread to arrive increments the generation and releases the others.
+
+	 * <p> A waiting thread first polls the generation counter for a number
+	 * of iterations given by the caller.  If the phase does not finish in
+	 * that time, the thread sleeps on a condition variable.  The last
+	 * thread only takes the mutex when some thread is sleeping, so a phase
+	 * where every thread is spinning makes no system call.
+
+	 * <p> The spin budget adapts to the caller: it doubles every time the
+	 * phase finished while spinning and it halves every time the caller had
+	 * to sleep.  Threads that usually wait for a short time spin, threads
+	 * that usually wait for a long time go to sleep quickly.
+	 */
+	class PhaseBarrier
+	{
+		/**
+		 * Number of threads that use the barrier.
+		 */
+		const unsigned int participants;
+		/**
+		 * Largest spin budget.  It is zero if threads should not spin.
+		 */
+		const int maximumSpin;
+		/**
+		 * Number of threads that have arrived in the current phase.
+		 */
+		boost::atomic<unsigned int> arrived;
+		/**
+		 * Current phase.
+		 */
+		boost::atomic<unsigned int> generation;
+		/**
+		 * Number of threads sleeping on the condition variable.
+		 */
+		boost::atomic<unsigned int> sleepers;
+		boost::mutex mutex;
+		boost::condition_variable wakeUp;
+
+		PhaseBarrier (const PhaseBarrier &);
+		PhaseBarrier &operator= (const PhaseBarrier &);
+	public:
+		/**
+		 * Smallest spin budget when spinning is enabled.
+		 */
+		static const int MINIMUM_SPIN = 16;
+		/**
+		 * Construct a barrier for the given number of threads.
+		 *
+		 * @param maximumSpin largest number of polling iterations before a
+		 * thread sleeps.
+		 */
+		PhaseBarrier (unsigned int participants, int maximumSpin);
+		/**
+		 * Return a spin budget to initialise the variable passed to method
+		 * {@code wait(int&)}.
+		 */
+		int initialSpin () const
+		{
+			return this->maximumSpin / 4;
+		}
+		/**
+		 * Wait until every thread has arrived.
+		 *
+		 * @param spin spin budget of the calling thread.  It is updated
+		 * according to how long the thread had to wait.
+		 */
+		void wait (int &spin);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifndef Q_MOC_RUN
+#include <boost/chrono.hpp>
+#endif
+
+#include "WorkerPool.h"
+
+using namespace Enki;
+
+static inline boost::uint64_t packRange (boost::uint32_t begin, boost::uint32_t end)
+{
+	return ((boost::uint64_t) end << 32) | begin;
+}
+
+std::string WorkerPool::WORKER_CPUS = "";
+
+WorkerPool *WorkerPool::sharedPool = NULL;
+
+unsigned int WorkerPool::sharedUsers = 0;
+
+boost::mutex WorkerPool::sharedMutex;
+
+WorkerPool::
+WorkerPool (unsigned int numberWorkers):
+	barrier (numberWorkers + 1, boost::thread::hardware_concurrency () > 1 ? WorkerPool::MAXIMUM_SPIN : 0),
+	job (NULL),
+	stopping (false)
+{
+	this->spin = this->barrier.initialSpin ();
+	this->cpus = WorkerPool::parseCpus (WorkerPool::WORKER_CPUS);
+	this->workers.reserve (numberWorkers);
+	for (unsigned int i = 0; i < numberWorkers; i++) {
+		this->workers.push_back (new Worker ());
+	}
+	for (unsigned int i = 0; i < numberWorkers; i++) {
+		std::cout << "Created thread " << (i + 1) << " of " << numberWorkers << '\n';
+		this->workers [i]->thread = new boost::thread (WorkerPool::workerLoop, this, i);
+	}
+}
+
+WorkerPool::
+~WorkerPool ()
+{
+	this->stopping = true;
+	this->barrier.wait (this->spin);
+	for (size_t i = 0; i < this->workers.size (); i++) {
+		this->workers [i]->thread->join ();
+		delete this->workers [i]->thread;
+		delete this->workers [i];
+	}
+}
+
+WorkerPool *WorkerPool::
+acquire (unsigned int numberWorkers)
+{
+	boost::lock_guard<boost::mutex> lock (WorkerPool::sharedMutex);
+	if (WorkerPool::sharedPool == NULL) {
+		WorkerPool::sharedPool = new WorkerPool (std::max (1u, numberWorkers));
+	}
+	else if (numberWorkers != 0 && WorkerPool::sharedPool->size () != numberWorkers) {
+		std::cerr << "Sharing a pool of " << WorkerPool::sharedPool->size () << " worker threads, "
+		          << numberWorkers << " were requested\n";
+	}
+	WorkerPool::sharedUsers++;
+	return WorkerPool::sharedPool;
+}
+
+void WorkerPool::
+release (WorkerPool *pool)
+{
+	boost::lock_guard<boost::mutex> lock (WorkerPool::sharedMutex);
+	if (pool != WorkerPool::sharedPool || WorkerPool::sharedUsers == 0) {
+		return ;
+	}
+	WorkerPool::sharedUsers--;
+	if (WorkerPool::sharedUsers == 0) {
+		pool->printStatistics (std::cout);
+		delete pool;
+		WorkerPool::sharedPool = NULL;
+	}
+}
+
+void WorkerPool::
+run (Job *job, int numberTasks)
+{
+	boost::lock_guard<boost::mutex> lock (this->runMutex);
+	const int numberWorkers = this->workers.size ();
+	this->job = job;
+	for (int i = 0; i < numberWorkers; i++) {
+		Worker *worker = this->workers [i];
+		worker->range.store (
+			packRange (i * numberTasks / numberWorkers, (i + 1) * numberTasks / numberWorkers),
+			boost::memory_order_relaxed);
+		worker->roundBusyTime = 0;
+	}
+	const boost::uint64_t start = WorkerPool::now ();
+	// release working threads
+	this->barrier.wait (this->spin);
+	// wait for working threads to finish
+	this->barrier.wait (this->spin);
+	const boost::uint64_t roundTime = WorkerPool::now () - start;
+	for (int i = 0; i < numberWorkers; i++) {
+		Worker *worker = this->workers [i];
+		worker->statistics.busyTime += worker->roundBusyTime;
+		worker->statistics.idleTime += roundTime - std::min (roundTime, worker->roundBusyTime);
+	}
+	this->job = NULL;
+}
+
+void WorkerPool::
+workerLoop (WorkerPool *pool, int index)
+{
+	pool->pinWorker (index);
+	Worker *self = pool->workers [index];
+	const int numberWorkers = pool->workers.size ();
+	int spin = pool->barrier.initialSpin ();
+	while (true) {
+		pool->barrier.wait (spin);
+		if (pool->stopping) {
+			break;
+		}
+		int task;
+		boost::uint64_t busy = 0;
+		while (pool->takeFront (self, task)) {
+			const boost::uint64_t start = WorkerPool::now ();
+			pool->job->runTask (task, index);
+			busy += WorkerPool::now () - start;
+			self->statistics.tasks++;
+		}
+		for (int i = 1; i < numberWorkers; i++) {
+			Worker *victim = pool->workers [(index + i) % numberWorkers];
+			while (pool->takeBack (victim, task)) {
+				const boost::uint64_t start = WorkerPool::now ();
+				pool->job->runTask (task, index);
+				busy += WorkerPool::now () - start;
+				self->statistics.tasks++;
+				self->statistics.stolenTasks++;
+			}
+		}
+		self->roundBusyTime = busy;
+		pool->barrier.wait (spin);
+	}
+}
+
+void WorkerPool::
+pinWorker (int index) const
+{
+	if (this->cpus.empty ()) {
+		return ;
+	}
+	const int cpu = this->cpus [index % this->cpus.size ()];
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO (&set);
+	CPU_SET (cpu, &set);
+	if (pthread_setaffinity_np (pthread_self (), sizeof (set), &set) != 0) {
+		std::cerr << "Could not pin worker thread " << (index + 1) << " to processor " << cpu << '\n';
+	}
+#else
+	std::cerr << "Pinning worker thread " << (index + 1) << " to processor " << cpu << " is not supported\n";
+#endif
+}
+
+std::vector<int> WorkerPool::
+parseCpus (const std::string &list)
+{
+	std::vector<int> result;
+	std::istringstream iss (list);
+	std::string item;
+	while (std::getline (iss, item, ',')) {
+		int first, last;
+		char dash;
+		std::istringstream range (item);
+		if (!(range >> first)) {
+			continue;
+		}
+		if (range >> dash >> last && dash == '-') {
+			for (int cpu = first; cpu <= last; cpu++) {
+				result.push_back (cpu);
+			}
+		}
+		else {
+			result.push_back (first);
+		}
+	}
+	if (result.empty () && list.find_first_not_of (" \t") != std::string::npos) {
+		std::cerr << "Invalid processor list: " << list << '\n';
+	}
+	return result;
+}
+
+bool WorkerPool::
+takeFront (Worker *worker, int &task)
+{
+	boost::uint64_t range = worker->range.load (boost::memory_order_relaxed);
+	while (true) {
+		const boost::uint32_t begin = (boost::uint32_t) range;
+		const boost::uint32_t end = (boost::uint32_t) (range >> 32);
+		if (begin >= end) {
+			return false;
+		}
+		if (worker->range.compare_exchange_weak (range, packRange (begin + 1, end), boost::memory_order_relaxed)) {
+			task = begin;
+			return true;
+		}
+	}
+}
+
+bool WorkerPool::
+takeBack (Worker *worker, int &task)
+{
+	boost::uint64_t range = worker->range.load (boost::memory_order_relaxed);
+	while (true) {
+		const boost::uint32_t begin = (boost::uint32_t) range;
+		const boost::uint32_t end = (boost::uint32_t) (range >> 32);
+		if (begin >= end) {
+			return false;
+		}
+		if (worker->range.compare_exchange_weak (range, packRange (begin, end - 1), boost::memory_order_relaxed)) {
+			task = end - 1;
+			return true;
+		}
+	}
+}
+
+boost::uint64_t WorkerPool::
+now ()
+{
+	return boost::chrono::duration_cast<boost::chrono::nanoseconds> (
+		boost::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+void WorkerPool::
+resetStatistics ()
+{
+	for (size_t i = 0; i < this->workers.size (); i++) {
+		Statistics &statistics = this->workers [i]->statistics;
+		statistics.busyTime = 0;
+		statistics.idleTime = 0;
+		statistics.tasks = 0;
+		statistics.stolenTasks = 0;
+	}
+}
+
+void WorkerPool::
+printStatistics (std::ostream &os) const
+{
+	const std::ios_base::fmtflags flags = os.flags ();
+	const std::streamsize precision = os.precision ();
+	for (size_t i = 0; i < this->workers.size (); i++) {
+		const Statistics &statistics = this->workers [i]->statistics;
+		const double busy = statistics.busyTime / 1e9;
+		const double idle = statistics.idleTime / 1e9;
+		os << "Worker " << (i + 1)
+		   << std::fixed << std::setprecision (3)
+		   << "  busy " << busy << "s"
+		   << "  idle " << idle << "s"
+		   << std::setprecision (1)
+		   << "  (" << (busy + idle > 0 ? 100 * busy / (busy + idle) : 0) << "% busy)"
+		   << "  tasks " << statistics.tasks
+		   << "  stolen " << statistics.stolenTasks
+		   << '\n';
+	}
+	os.flags (flags);
+	os.precision (precision);
+}
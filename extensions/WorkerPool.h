@@ -0,0 +1,247 @@
+#ifndef __WORKER_POOL_H
+#define __WORKER_POOL_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+#ifndef Q_MOC_RUN
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#endif
+
+#include "PhaseBarrier.h"
+
+namespace Enki
+{
+	/**
+	 * A pool of worker threads that run the tasks of a job.  The main
+	 * thread calls method {@code run(Job*,int)}, which releases the worker
+	 * threads and waits until every task has been run.  The main thread and
+	 * the worker threads synchronise with a {@code PhaseBarrier}, twice per
+	 * call: to start the job and to finish it.  Short jobs are started and
+	 * finished without system calls.
+
+	 * <p> The tasks are initially split in contiguous ranges, one per
+	 * worker.  A worker takes tasks from the front of its own range.  When
+	 * its range is empty, it steals tasks from the back of the range of
+	 * other workers.  A range is stored in a single atomic word, so taking
+	 * and stealing are a compare-and-swap.
+
+	 * <p> The pool measures, for each worker, the time spent running tasks
+	 * (busy time) and the remaining time of each call to method {@code
+	 * run(Job*,int)} (idle time).  Idle time includes waking up and waiting
+	 * for other workers to finish.
+
+	 * <p> Worker threads can be pinned to processors.  Worker {@code i} is
+	 * pinned to the processor in position {@code i} modulo the size of the
+	 * list given in {@code WORKER_CPUS}.
+
+	 * <p> Physic simulations should not create their own pool.  They share
+	 * a process wide pool obtained with method {@code acquire(unsigned
+	 * int)} and give it back with method {@code release(WorkerPool*)}.
+	 * Several simulations then use the same cores without creating more
+	 * threads than hardware threads.  Jobs submitted by different threads
+	 * are run one after the other.
+	 */
+	class WorkerPool
+	{
+	public:
+		/**
+		 * Work submitted to the pool.
+		 */
+		class Job
+		{
+		public:
+			virtual ~Job () {}
+			/**
+			 * Run the given task.
+			 *
+			 * @param task index of the task, between zero and the number of
+			 * tasks given to method {@code run(Job*,int)}.
+			 *
+			 * @param worker index of the worker thread that is running the
+			 * task.  It can be used to access per worker data.
+			 */
+			virtual void runTask (int task, int worker) = 0;
+		};
+		/**
+		 * Time measurements of a worker thread.  Times are in nanoseconds.
+		 */
+		struct Statistics
+		{
+			boost::uint64_t busyTime;
+			boost::uint64_t idleTime;
+			/**
+			 * Number of tasks run by the worker.
+			 */
+			boost::uint64_t tasks;
+			/**
+			 * Number of tasks stolen from other workers.
+			 */
+			boost::uint64_t stolenTasks;
+		};
+	private:
+		/**
+		 * Information and state of a worker thread.
+		 */
+		struct Worker
+		{
+			/**
+			 * Range of tasks that this worker still has to run.  The lower
+			 * 32 bits contain the first task and the upper 32 bits contain
+			 * the task after the last.
+			 */
+			boost::atomic<boost::uint64_t> range;
+			/**
+			 * Time spent running tasks in the current call to method {@code
+			 * run(Job*,int)}.
+			 */
+			boost::uint64_t roundBusyTime;
+			Statistics statistics;
+			boost::thread *thread;
+
+			Worker ():
+				range (0),
+				roundBusyTime (0),
+				thread (NULL)
+			{
+				this->statistics.busyTime = 0;
+				this->statistics.idleTime = 0;
+				this->statistics.tasks = 0;
+				this->statistics.stolenTasks = 0;
+			}
+		};
+		std::vector<Worker *> workers;
+		/**
+		 * Barrier shared by the worker threads and the main thread.
+		 */
+		PhaseBarrier barrier;
+		/**
+		 * Spin budget of the main thread in the barrier.
+		 */
+		int spin;
+		/**
+		 * Processors where worker threads are pinned.
+		 */
+		std::vector<int> cpus;
+		/**
+		 * Serialises calls to method {@code run(Job*,int)}.
+		 */
+		boost::mutex runMutex;
+		/**
+		 * The process wide pool.
+		 */
+		static WorkerPool *sharedPool;
+		/**
+		 * Number of users of the process wide pool.
+		 */
+		static unsigned int sharedUsers;
+		/**
+		 * Protects fields {@code sharedPool} and {@code sharedUsers}.
+		 */
+		static boost::mutex sharedMutex;
+		/**
+		 * The job being run.
+		 */
+		Job *job;
+		/**
+		 * Set by the destructor to stop worker threads.
+		 */
+		bool stopping;
+
+		WorkerPool (const WorkerPool &);
+		WorkerPool &operator= (const WorkerPool &);
+	public:
+		/**
+		 * Comma separated list of processors or ranges of processors, such
+		 * as {@code 0-7,16-23}, where worker threads are pinned.  If empty,
+		 * worker threads are not pinned.
+		 */
+		static std::string WORKER_CPUS;
+		/**
+		 * Largest number of polling iterations in the barrier before a
+		 * thread sleeps.  Spinning is disabled on computers with a single
+		 * hardware thread.
+		 */
+		static const int MAXIMUM_SPIN = 1 << 14;
+		/**
+		 * Create a pool with the given number of worker threads.
+		 */
+		WorkerPool (unsigned int numberWorkers);
+		/**
+		 * Stop and join the worker threads.
+		 */
+		~WorkerPool ();
+		/**
+		 * Return the process wide pool.  The first call creates it with the
+		 * given number of worker threads.  Later calls return the same pool,
+		 * regardless of the requested number of worker threads.  Zero
+		 * workers means any number: the pool is created with one worker
+		 * thread and a different size is not reported.
+		 */
+		static WorkerPool *acquire (unsigned int numberWorkers);
+		/**
+		 * Give back the process wide pool.  When the last user gives it
+		 * back, worker statistics are printed and the worker threads are
+		 * joined.
+		 */
+		static void release (WorkerPool *pool);
+		/**
+		 * Run the tasks of the given job and return when all of them have
+		 * been run.
+		 */
+		void run (Job *job, int numberTasks);
+		/**
+		 * Return the number of worker threads.
+		 */
+		unsigned int size () const
+		{
+			return this->workers.size ();
+		}
+		/**
+		 * Return the time measurements of the given worker.
+		 */
+		const Statistics &getStatistics (int worker) const
+		{
+			return this->workers [worker]->statistics;
+		}
+		void resetStatistics ();
+		/**
+		 * Print the busy and idle time of every worker.
+		 */
+		void printStatistics (std::ostream &os) const;
+	private:
+		static void workerLoop (WorkerPool *pool, int index);
+		/**
+		 * Pin the calling thread to the processor of the given worker.
+		 */
+		void pinWorker (int index) const;
+		/**
+		 * Parse a processor list in the format of field {@code
+		 * WORKER_CPUS}.
+		 */
+		static std::vector<int> parseCpus (const std::string &list);
+		/**
+		 * Return the current time in nanoseconds.
+		 */
+		static boost::uint64_t now ();
+		/**
+		 * Take a task from the front of the range of the given worker.
+		 */
+		bool takeFront (Worker *worker, int &task);
+		/**
+		 * Take a task from the back of the range of the given worker.
+		 */
+		bool takeBack (Worker *worker, int &task);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
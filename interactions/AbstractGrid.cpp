@@ -1,4 +1,5 @@
 #include <limits>
+#include <cmath>
 
 #ifdef DEBUG
 #include <iostream>
@@ -11,13 +12,18 @@ using namespace Enki;
 
 Point gridSize (const ExtendedWorld *world, double gridScale, double borderSize);
 Point gridOrigin (const ExtendedWorld *world, double gridScale, double borderSize);
+vector<GridSpan> gridSpans (const ExtendedWorld *world, double gridScale, double borderSize, const Vector &size, const Vector &origin);
+
+double AbstractGrid::UNBOUNDED_MARGIN = 20;
 
 AbstractGrid::
 AbstractGrid (const ExtendedWorld *world, double gridScale, double borderSize):
 	gridScale (gridScale),
 	borderSize (borderSize),
 	size (gridSize (world, gridScale, borderSize)),
-	origin (gridOrigin (world, gridScale, borderSize))
+	origin (gridOrigin (world, gridScale, borderSize)),
+	layout (this->size.x, this->size.y, AbstractGrid::HALO),
+	spans (gridSpans (world, gridScale, borderSize, this->size, this->origin))
 {
 }
 
@@ -26,7 +32,9 @@ AbstractGrid (double gridScale, double borderSize, const Vector &size, const Vec
 	gridScale (gridScale),
 	borderSize (borderSize),
 	size (size),
-	origin (origin)
+	origin (origin),
+	layout (size.x, size.y, AbstractGrid::HALO),
+	spans (gridSpans (NULL, gridScale, borderSize, size, origin))
 {
 }
 
@@ -46,7 +54,7 @@ void gridProperties (const ExtendedWorld *world, double gridScale, double border
 		break;
 	case World::WALLS_NONE: {
 		min = Vector (std::numeric_limits<double>::max (), std::numeric_limits<double>::max ());
-		max = Vector (std::numeric_limits<double>::min (), std::numeric_limits<double>::min ());
+		max = Vector (-std::numeric_limits<double>::max (), -std::numeric_limits<double>::max ());
 		Enki::World::ObjectsIterator iterator = world->objects.begin ();
 		while (iterator != world->objects.end ()) {
 			Enki::PhysicalObject* po = *iterator;
@@ -56,6 +64,14 @@ void gridProperties (const ExtendedWorld *world, double gridScale, double border
 			max.y = std::max (max.y, po->pos.y);
 			iterator++;
 		}
+		if (world->objects.empty ()) {
+			min = max = Vector (0, 0);
+		}
+		// leave room for objects that move away from their initial position
+		min.x -= AbstractGrid::UNBOUNDED_MARGIN;
+		min.y -= AbstractGrid::UNBOUNDED_MARGIN;
+		max.x += AbstractGrid::UNBOUNDED_MARGIN;
+		max.y += AbstractGrid::UNBOUNDED_MARGIN;
 		break;
 	}
 	default:
@@ -103,3 +119,38 @@ Point gridOrigin (const ExtendedWorld *world, double gridScale, double borderSiz
 	gridProperties (world, gridScale, borderSize, NULL, &result);
 	return result;
 }
+
+/**
+ * Compute the active cells of each column of a grid.  Without a world,
+ * every cell that is not a border cell is active.
+ */
+vector<GridSpan> gridSpans (const ExtendedWorld *world, double gridScale, double borderSize, const Vector &size, const Vector &origin)
+{
+	const int sizeX = size.x;
+	const int sizeY = size.y;
+	GridSpan interior = {1, sizeY - 1};
+	GridSpan empty = {0, 0};
+	vector<GridSpan> result (sizeX, interior);
+	if (sizeX > 0) {
+		result [0] = empty;
+		result [sizeX - 1] = empty;
+	}
+	if (world == NULL || world->wallsType != World::WALLS_CIRCULAR) {
+		return result;
+	}
+	const double radius = world->r + borderSize;
+	for (int x = 1; x < sizeX - 1; x++) {
+		const double dx = origin.x + x * gridScale;
+		if (fabs (dx) > radius) {
+			result [x] = empty;
+			continue;
+		}
+		const double half = sqrt (radius * radius - dx * dx);
+		result [x].ymin = std::max (1, (int) ceil ((-half - origin.y) / gridScale));
+		result [x].ymax = std::min (sizeY - 1, (int) floor ((half - origin.y) / gridScale) + 1);
+		if (result [x].ymin >= result [x].ymax) {
+			result [x] = empty;
+		}
+	}
+	return result;
+}
@@ -5,6 +5,8 @@
 
 #include "extensions/ExtendedWorld.h"
 #include "extensions/PhysicSimulation.h"
+#include "interactions/GridField.h"
+#include "interactions/GridTiling.h"
 
 namespace Enki
 {
@@ -20,9 +22,13 @@ namespace Enki
 	 * characteristics.  Classes {@code AbstractGridSimulation} and {@code
 	 * AbstractGridProperties} contain the grid data.
 
-	 * <p> Note that in the absence of world walls if objects can move
-	 * behind the grid coordinates, care must be taken to return a valid
-	 * physical quantity or physical quantity.
+	 * <p> Note that in the absence of world walls objects can move
+	 * beyond the grid coordinates.  Subclasses return the environment
+	 * value for positions outside the grid and lose writes to them, and
+	 * shapes drawn in grid properties are clipped to the grid.  Field
+	 * {@code UNBOUNDED_MARGIN} enlarges the grid of such worlds.  A large
+	 * grid need not be dense: subclasses may store only the tiles that are
+	 * written, see method {@code allocateCells(int,int,int,int)}.
 	 */
 	class AbstractGrid:
 		public virtual PhysicSimulation
@@ -40,6 +46,87 @@ namespace Enki
 		 * Smallest world coordinates of cell (0,0) in the grid.
 		 */
 		const Enki::Vector origin;
+		/**
+		 * Memory layout shared by every plane of this grid.
+		 */
+		const GridLayout layout;
+		/**
+		 * Cells of each column that are updated by grid simulations.
+		 * Border cells are never active.  If the world has circular walls,
+		 * cells farther from the world centre than the wall radius plus the
+		 * border size are not active either.  Inactive cells are not
+		 * updated and act as fixed temperature boundaries, as border cells.
+		 */
+		const std::vector<GridSpan> spans;
+		/**
+		 * Width of the halo ring that surrounds grid planes.
+		 */
+		static const int HALO = 1;
+		/**
+		 * Distance added around the objects of a world without walls when
+		 * the grid is created, 20 cm by default.  Such a grid only covers
+		 * the objects present at initialisation time, plus this margin.
+		 * Positions outside the grid read the environment value and writes
+		 * to them are lost, so heat written there by objects that are added
+		 * later or that move beyond the margin is not simulated.
+		 */
+		static /*const*/ double UNBOUNDED_MARGIN;
+		/**
+		 * Return true if the given cell is updated by grid simulations.
+		 */
+		bool isActive (int x, int y) const
+		{
+			return
+				x >= 0 && x < (int) this->spans.size ()
+				&& y >= this->spans [x].ymin && y < this->spans [x].ymax;
+		}
+		/**
+		 * Return true if the cell at the given world position is updated by
+		 * grid simulations.
+		 */
+		bool isActiveAt (const Enki::Vector &position) const
+		{
+			int x, y;
+			toIndex (position, x, y);
+			return isActive (x, y);
+		}
+		/**
+		 * Find the next block of active cells of rectangle {@code
+		 * [x,xmax)} by {@code [ymin,ymax)}.  A block is a maximal run of
+		 * columns that have the same active cells in the rectangle.  Return
+		 * false if there are no more active cells.  Parameter {@code x} is
+		 * advanced past the returned block, so that the following loop
+		 * visits every active cell of the rectangle once:
+
+		 * <pre>
+		 * GridTile block;
+		 * int x = xmin;
+		 * while (nextActiveBlock (x, xmax, ymin, ymax, block)) {
+		 *     ...
+		 * }
+		 * </pre>
+		 */
+		bool nextActiveBlock (int &x, int xmax, int ymin, int ymax, GridTile &block) const
+		{
+			for (; x < xmax; x++) {
+				const int low = std::max (ymin, this->spans [x].ymin);
+				const int high = std::min (ymax, this->spans [x].ymax);
+				if (low >= high) {
+					continue;
+				}
+				block.xmin = x;
+				block.ymin = low;
+				for (x++; x < xmax; x++) {
+					if (std::max (ymin, this->spans [x].ymin) != low || std::min (ymax, this->spans [x].ymax) != high) {
+						break;
+					}
+				}
+				block.xmax = x;
+				block.ymax = high;
+				return true;
+			}
+			return false;
+		}
 
 	protected:
 		/**
@@ -75,6 +162,16 @@ namespace Enki
 		{
 			return round (value / this->gridScale);
 		}
+		/**
+		 * Called before the cells of rectangle {@code [xmin,xmax)} by
+		 * {@code [ymin,ymax)} are written by the drawing and fill methods of
+		 * grid properties and simulations.  The rectangle may extend beyond
+		 * the grid.  Subclasses that store their planes sparsely allocate the
+		 * cells here.  The default implementation does nothing.
+		 */
+		virtual void allocateCells (int xmin, int ymin, int xmax, int ymax)
+		{
+		}
 	};
 }
 
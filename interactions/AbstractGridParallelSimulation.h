@@ -1,148 +1,101 @@
 #ifndef __ABSTRACT_GRID_PARALLEL_SIMULATION_H
 #define __ABSTRACT_GRID_PARALLEL_SIMULATION_H
 
-#ifndef Q_MOC_RUN
-#include <boost/thread.hpp>
-#include <boost/interprocess/sync/interprocess_semaphore.hpp>
-#include <boost/foreach.hpp>
-#endif
 #include "interactions/AbstractGridSimulation.h"
+#include "interactions/GridTiling.h"
 #include "extensions/ExtendedWorld.h"
+#include "extensions/WorkerPool.h"
 
 namespace Enki
 {
 	/**
 	 * This class provides a thread manager to update grid cells in
-	 * parallel.  The grid is divided in rectangular blocks.  Each block is
-	 * assigned a worker thread.  The maximum number of worker threads is
-	 * equal to the number of physical cores in the computer.  Every time
-	 * step the main thread wakes up the worker threads so they update their
-	 * respective block.  The main thread sleeps until all worker threads
-	 * finish updating their blocks.
+	 * parallel.  The grid is divided in rectangular tiles.  Every time step
+	 * the main thread gives the tiles to the process wide pool of worker
+	 * threads and sleeps until all tiles have been updated.  The maximum
+	 * number of worker threads is equal to the number of hardware threads
+	 * in the computer.
+	 *
+	 * <p> Each worker thread starts with a contiguous range of tiles.  A
+	 * worker thread that finishes its range steals tiles from the others.
+	 * This balances the load when tiles do not take the same time to
+	 * update, or when worker threads are delayed by the operating system.
+	 * The pool measures how long each worker thread was busy and idle.
 	 *
-	 * <p> The worker thread semaphores and the main thread semaphore are
-	 * initialised to zero.  In the beginning, the worker thread must wait
-	 * for the signal from the main thread.  Also the main thread must wait
-	 * for the worker threads to finish updating their rectangular blocks.
+	 * <p> Grid planes are first written by the worker threads, each one
+	 * writing the columns of the tiles it starts with.  On a NUMA computer
+	 * the memory of a tile is placed on the node of the worker thread that
+	 * usually updates it.
 	 *
 	 * <p> Template {@code class G} should be a specialisation of this class
 	 * and should provide a method with the following signature: {@code void
-	 * update(double deltaTime, int xmin, int ymin, int xmax, int ymax)}.
-	 * This method receives the lower left and upper right corners of the
-	 * rectangular block.
+	 * updateTile(double deltaTime, int substeps, int tile)}.  This method
+	 * receives the index of a tile in field {@code tiling} and advances the
+	 * tile {@code substeps} times before the worker thread synchronises
+	 * with the main thread.  The result must be written in the next grid.
 	 */
 	template<class G, class T>
 	class AbstractGridParallelSimulation :
-		public AbstractGridSimulation<T>
+		public AbstractGridSimulation<T>,
+		private WorkerPool::Job
 	{
 		/**
-		 * Take into account processing of border grid cells.  If they should
-		 * not be updated, adjust parameter {@code value}, otherwise just
-		 * return this parameter.
+		 * The worker threads, shared with other physic simulations.
 		 */
-		static int processBorder (int size, bool flag, int value)
-		{
-			if (!flag) {
-				if (value == 0) {
-					return 1;
-				}
-				else if (value == size) {
-					return size - 1;
-				}
-			}
-			return value;
-		}
+		WorkerPool *pool;
 		/**
-		 * Information used by each worker thread to update its rectangular
-		 * block of the grid.  A worker thread sleeps until the main thread
-		 * wakes it every time step.  The worker thread calls the update
-		 * function and wakes up the main thread.
-		 *
-		 * <p> The update function is a function of class template {@code G}.
-		 *
-		 * <p> The rectangular block depends on grid size.  If the grid width
-		 * is bigger than its height, the grid is divided in the horizontal
-		 * axis, otherwise it is divided in the vertical axis.  Border grid
-		 * cells may not be updated, so they can be excluded from the
-		 * rectangular block.
+		 * The concrete class with the grid cell update function.
 		 */
-		struct ThreadState
-		{
-			/**
-			 * Left side of the  rectangular block.
-			 */
-			const int xmin;
-			/**
-			 * Right side of the rectangular block
-			 */
-			const int xmax;
-			/**
-			 * Lower side of the rectangular block.
-			 */
-			const int ymin;
-			/**
-			 * Upper side of the rectangular block.
-			 */
-			const int ymax;
-			/**
-			 * Delta time used by the function that updates grid cells.
-			 */
-			double deltaTime;
-			/**
-			 * The concrete class with the grid cell update function.
-			 */
-			G *grid;
-			/**
-			 * Worker thread sleep semaphore used to wait for the signal from
-			 * the main thread.
-			 */
-			boost::interprocess::interprocess_semaphore wait;
-			/**
-			 * Main thread semaphore used to signal it that the worker thread
-			 * has finished updating its rectangular block.
-			 */
-			boost::interprocess::interprocess_semaphore *fine;
-			/**
-			 * The thread that is using this thread information and state.
-			 */
-			boost::thread *thread;
-			/**
-			 * Construct a new worker thread information.
-			 */
-			ThreadState (G *ags, bool borderFlag, int index, int howMany, boost::interprocess::interprocess_semaphore *fine):
-				xmin (processBorder (ags->size.x, borderFlag, ags->size.x > ags->size.y  ?   index      * ags->size.x / howMany  :  0)),
-				xmax (processBorder (ags->size.x, borderFlag, ags->size.x > ags->size.y  ?  (index + 1) * ags->size.x / howMany  :  ags->size.x)),
-				ymin (processBorder (ags->size.y, borderFlag, ags->size.x > ags->size.y  ?  0          :  index      * ags->size.y / howMany)),
-				ymax (processBorder (ags->size.y, borderFlag, ags->size.x > ags->size.y  ?  ags->size.y  : (index + 1) * ags->size.y / howMany)),
-				grid (ags),
-				wait (0),
-				fine (fine)
-			{
-			}
-		};
+		G *model;
 		/**
-		 * Array of worker thread information.
+		 * Delta time used by the function that updates grid cells.
 		 */
-		std::vector<ThreadState *> threadsState;
+		double deltaTime;
 		/**
-		 * Semaphore used by the main thread to wait for every worker thread
-		 * to finish updating their respective rectangular block of the grid.
+		 * How many times each tile is advanced before signalling the main
+		 * thread.
 		 */
-		boost::interprocess::interprocess_semaphore *fine;
+		int substeps;
 		/**
-		 * Worker thread code.  The worker thread sleeps until the main
-		 * thread wakes up to update its rectangular block.  After updating
-		 * it wakes up the main thread.
+		 * Indexes of the tiles that are updated, or {@code NULL} if every
+		 * tile is updated.
 		 */
-		static void updatePartialGrid (ThreadState *threadState)
+		const std::vector<int> *tiles;
+		/**
+		 * Job that first writes the columns of a grid plane.  Task {@code i}
+		 * writes the columns of tile column {@code i}.  The first and last
+		 * tasks also write the border and halo columns.
+		 */
+		template<class U>
+		class FirstTouchJob:
+			public WorkerPool::Job
 		{
-			while (true) {
-				threadState->wait.wait ();
-				threadState->grid->updateGrid (threadState->deltaTime, threadState->xmin, threadState->ymin, threadState->xmax, threadState->ymax);
-				threadState->fine->post ();
+			const GridTiling &tiling;
+			GridField<U> &field;
+			const U value;
+		public:
+			FirstTouchJob (const GridTiling &tiling, GridField<U> &field, const U &value):
+				tiling (tiling),
+				field (field),
+				value (value)
+			{
 			}
-		}
+
+			virtual void runTask (int task, int worker)
+			{
+				const GridLayout &layout = this->field.getLayout ();
+				const GridTile &tile = this->tiling [task * this->tiling.getRows ()];
+				const int xmin = task == 0 ? -layout.halo : tile.xmin;
+				const int xmax = task == this->tiling.getColumns () - 1 ? layout.sizeX + layout.halo : tile.xmax;
+				this->field.fillColumns (xmin, xmax, this->value);
+			}
+		};
 	protected:
+		/**
+		 * Tiles of the grid that are updated.  Border grid cells may not be
+		 * updated, so they can be excluded from the tiles.
+		 */
+		GridTiling tiling;
 		/**
 		 * This constructor should be used by a class that inherit multiple
 		 * times class {@code AbstractGrid}.
@@ -153,12 +106,16 @@ namespace Enki
 		 * @param grid The class with the grid cell update function
 		 *
 		 * @param borderFlag Whether border grid cells should be updated or not.
+		 *
+		 * @param touch Whether the planes are first written by the worker
+		 * threads.  If false, the subclass must initialise them, for
+		 * instance tile by tile in a sparse grid.
 		 */
-		AbstractGridParallelSimulation (double parallelismLevel, G *grid, bool borderFlag):
+		AbstractGridParallelSimulation (double parallelismLevel, G *grid, bool borderFlag, bool touch = true):
 			AbstractGrid (NULL, -1, -1),
-			AbstractGridSimulation<T> ()
+			AbstractGridSimulation<T> (false)
 		{
-			this->initFields (parallelismLevel, grid, borderFlag);
+			this->initFields (parallelismLevel, grid, borderFlag, touch);
 		}
 		/**
 		 * Construct a new grid.
@@ -169,35 +126,54 @@ namespace Enki
 		 * @param grid The class with the grid cell update function
 		 *
 		 * @param borderFlag Whether border grid cells should be updated or not.
+		 *
+		 * @param touch Whether the planes are first written by the worker
+		 * threads.  If false, the subclass must initialise them.
 		 */
-		AbstractGridParallelSimulation (const ExtendedWorld *world, double gridScale, double borderSize, double parallelismLevel, G *grid, bool borderFlag):
-			AbstractGridSimulation<T> (world, gridScale, borderSize)
+		AbstractGridParallelSimulation (const ExtendedWorld *world, double gridScale, double borderSize, double parallelismLevel, G *grid, bool borderFlag, bool touch = true):
+			AbstractGridSimulation<T> (world, gridScale, borderSize, false)
 		{
-			this->initFields (parallelismLevel, grid, borderFlag);
+			this->initFields (parallelismLevel, grid, borderFlag, touch);
 		}
 		/**
-		 * Destructor.
-		 *
-		 * TODO: stop threads.
+		 * Destructor.  Give back the worker threads.  They are stopped when
+		 * no other simulation uses them.
 		 */
-		virtual ~AbstractGridParallelSimulation () {}
+		virtual ~AbstractGridParallelSimulation ()
+		{
+			WorkerPool::release (this->pool);
+		}
 
 	public:
 		/**
 		 * Return the number of threads that are created for the given
 		 * concurrency level.  A value of zero means no concurrency: there is
 		 * only one thread.  A value of one means take advantage of all
-		 * available CPU multi threading capabilities.
+		 * available CPU multi threading capabilities.  A negative value, for
+		 * auxiliary grids, shares the pool of the other grids whatever its
+		 * size, see method {@code WorkerPool::acquire(unsigned int)}.
 		 *
 		 * @param parallelismLevel The parallelism level to be used.
 		 */
 		static unsigned int numberThreads (double parallelismLevel)
 		{
+			if (parallelismLevel < 0) {
+				return 0;
+			}
 			// unsigned int result = boost::thread::physical_concurrency ();
 			unsigned int result = boost::thread::hardware_concurrency ();
 			result = (unsigned int) (0.5 + result * parallelismLevel);
 			return (result == 0 ? 1 : result);
 		}
+		/**
+		 * Print how long each worker thread was busy updating tiles and how
+		 * long it was idle.
+		 */
+		void printWorkerStatistics (std::ostream &os) const
+		{
+			os << "Grid of " << this->tiling.size () << " tiles\n";
+			this->pool->printStatistics (os);
+		}
 	private:
 		/**
 		 * Initialise instance fields after the constructor has calculated
@@ -205,39 +181,73 @@ namespace Enki
 		 *
 		 * <p> With C++11 this would be in the most general constructor.
 		 */
-		void initFields (double parallelismLevel, G *grid, bool borderFlag)
+		void initFields (double parallelismLevel, G *grid, bool borderFlag, bool touch)
 		{
-			const unsigned int numberThreads = AbstractGridParallelSimulation::numberThreads (parallelismLevel);
-			this->fine = new boost::interprocess::interprocess_semaphore (0);
-			int i = numberThreads - 1;
-			this->threadsState.reserve (numberThreads);
-			while (i >= 0) {
-				std::cout << "Created thread " << (numberThreads - i) << " of " << numberThreads << '\n';
-				ThreadState *threadState = new ThreadState (grid, borderFlag, i, numberThreads, this->fine);
-				threadState->thread = new boost::thread (AbstractGridParallelSimulation::updatePartialGrid, threadState);
-				this->threadsState.push_back (threadState);
-				i--;
+			const int border = borderFlag ? 0 : 1;
+			this->model = grid;
+			this->deltaTime = 0;
+			this->substeps = 1;
+			this->tiles = NULL;
+			this->tiling.init (
+				border, border, this->size.x - border, this->size.y - border,
+				GridTiling::TILE_WIDTH, GridTiling::TILE_HEIGHT);
+			this->pool = WorkerPool::acquire (AbstractGridParallelSimulation::numberThreads (parallelismLevel));
+			if (touch) {
+				this->firstTouch (this->grid [0], T ());
+				this->firstTouch (this->grid [1], T ());
 			}
 		}
+		/**
+		 * Worker thread code.  Update the given tile.
+		 */
+		virtual void runTask (int task, int worker)
+		{
+			const int tile = this->tiles == NULL ? task : (*this->tiles) [task];
+			this->model->updateTile (this->deltaTime, this->substeps, tile);
+		}
 	protected:
 		/**
-		 * Updates the grid cells.  Wake up all the worker threads and wait
-		 * for them to finish updating their respective rectangular block.
-		 * After that we update field {@code adtIndex}.
+		 * Set every element of the given plane to the given value, using
+		 * the worker threads.  Subclasses should call this method for
+		 * planes that were allocated without being initialised.
 		 */
-		void updateState (double deltaTime)
+		template<class U>
+		void firstTouch (GridField<U> &field, const U &value)
 		{
-			int nextAdtIndex = 1 - this->adtIndex;
-			// wake up working threads
-			BOOST_FOREACH (ThreadState *threadState, this->threadsState) {
-				threadState->deltaTime = deltaTime;
-				threadState->wait.post ();
+			if (this->tiling.size () == 0) {
+				field.fill (value);
+				return ;
 			}
-			// wait for working threads to finish update step
-			for (int i = this->threadsState.size (); i > 0; i--) {
-				this->fine->wait ();
-			}
-			this->adtIndex = nextAdtIndex;
+			FirstTouchJob<U> job (this->tiling, field, value);
+			this->pool->run (&job, this->tiling.getColumns ());
+		}
+		/**
+		 * Run the given job in the worker threads.  Subclasses use it for
+		 * updates that are not made of independent tiles, for instance with
+		 * one task per tile column of field {@code tiling}.
+		 */
+		void runJob (WorkerPool::Job *job, int numberTasks)
+		{
+			this->pool->run (job, numberTasks);
+		}
+		/**
+		 * Updates the grid cells.  Give every tile to the worker threads and
+		 * wait for them to finish.  After that we update field {@code
+		 * adtIndex}.
+		 *
+		 * @param substeps how many times the grid is advanced.
+		 *
+		 * @param tiles indexes of the tiles to update, or {@code NULL} to
+		 * update every tile.  Tiles that are not updated must already hold
+		 * the same values in both grids.
+		 */
+		void updateState (double deltaTime, int substeps = 1, const std::vector<int> *tiles = NULL)
+		{
+			this->deltaTime = deltaTime;
+			this->substeps = substeps;
+			this->tiles = tiles;
+			this->pool->run (this, tiles == NULL ? this->tiling.size () : tiles->size ());
+			this->adtIndex = 1 - this->adtIndex;
 		}
 	};
 }
@@ -12,6 +12,7 @@
 #include "extensions/ExtendedWorld.h"
 #include "extensions/PhysicSimulation.h"
 #include "interactions/AbstractGrid.h"
+#include "interactions/GridField.h"
 
 namespace Enki
 {
@@ -66,25 +67,33 @@ namespace Enki
 
 	protected:
 		/**
-		 * Grid with the physical properties.
+		 * Grid with the physical properties.  It uses the layout of field
+		 * {@code AbstractGrid::layout}, so a linear cell index is the same
+		 * in this plane and in the planes of {@code AbstractGridSimulation}.
 		 */
-		std::vector<std::vector<T> > prop;
+		GridField<T> prop;
 		/**
 		 * This constructor should be used by a class that inherit multiple
 		 * times class {@code AbstractGrid}.
+		 *
+		 * @param touch whether the plane is initialised.  If false, the
+		 * subclass must write every element of the plane.
 		 */
-		AbstractGridProperties ():
+		AbstractGridProperties (bool touch = true):
 			AbstractGrid (NULL, -1, -1)
 		{
-			this->initData ();
+			this->initData (touch);
 		}
 		/**
 		 * Construct a new grid.
+		 *
+		 * @param touch whether the plane is initialised.  If false, the
+		 * subclass must write every element of the plane.
 		 */
-		AbstractGridProperties (const ExtendedWorld *world, double gridScale, double borderSize):
+		AbstractGridProperties (const ExtendedWorld *world, double gridScale, double borderSize, bool touch = true):
 			AbstractGrid (world, gridScale, borderSize)
 		{
-			this->initData ();
+			this->initData (touch);
 		}
 
 		virtual ~AbstractGridProperties () {}
@@ -96,12 +105,9 @@ namespace Enki
 		 *
 		 * <p> With C++11 this would be in the most general constructor.
 		 */
-		void initData ()
+		void initData (bool touch)
 		{
-			this->prop.resize (this->size.x);
-			for (int x = 0; x < this->size.x; x++) {
-				this->prop [x].resize (this->size.y);
-			}
+			this->prop.resize (this->layout, touch);
 			this->edgeTable.resize (this->size.y, NULL_EDGE);
 			this->edges.resize (this->size.y);
 			BOOST_FOREACH (Edge &edge, this->edges) {
@@ -118,6 +124,7 @@ namespace Enki
 		 */
 		void fillGrid (T value)
 		{
+			this->allocateCells (0, 0, this->size.x, this->size.y);
 			for (int x = this->size.x - 1; x >= 0; x--) {
 				for (int y = this->size.y - 1; y >= 0; y--) {
 					this->prop [x][y] = value;
@@ -131,6 +138,7 @@ namespace Enki
 		 */
 		void fillGrid (UpdateFunction update)
 		{
+			this->allocateCells (0, 0, this->size.x, this->size.y);
 			for (int x = this->size.x - 1; x >= 0; x--) {
 				for (int y = this->size.y - 1; y >= 0; y--) {
 					(*update) (this->prop [x][y]);
@@ -156,10 +164,11 @@ namespace Enki
 		 */
 		void drawLine (UpdateFunction update, int ax, int ay, int bx, int by)
 		{
+			this->allocateCells (std::min (ax, bx), std::min (ay, by), std::max (ax, bx) + 1, std::max (ay, by) + 1);
 			if (ax == bx) {
 				int y;
 				for (y = ay; y <= by; y++) {
-					(*update) (this->prop [ax][y]);
+					this->updateCell (update, ax, y);
 				}
 			}
 			else {
@@ -171,10 +180,10 @@ namespace Enki
 				int sy = (by > ay ? 1 : -1);
 				y = ay;
 				for (x = ax; x <= bx; x++) {
-					(*update) (this->prop [x][y]);
+					this->updateCell (update, x, y);
 					error += deltaError;
 					while (error >= 0.5) {
-						(*update) (this->prop [x][y]);
+						this->updateCell (update, x, y);
 						y += sy;
 						error -= 1.0;
 					}
@@ -197,10 +206,11 @@ namespace Enki
 			int ax, ay, bx, by;
 			toIndex (lowerLeft, ax, ay);
 			toIndex (upperRight, bx, by);
+			this->allocateCells (ax, ay, bx + 1, by + 1);
 			int x, y;
 			for (x = ax; x <= bx; x++) {
 				for (y = ay; y <= by; y++) {
-					this->prop [x][y] = value;
+					this->setCell (x, y, value);
 				}
 			}
 		}
@@ -220,10 +230,11 @@ namespace Enki
 			int ax, ay, bx, by;
 			toIndex (lowerLeft, ax, ay);
 			toIndex (upperRight, bx, by);
+			this->allocateCells (ax, ay, bx + 1, by + 1);
 			int x, y;
 			for (x = ax; x <= bx; x++) {
 				for (y = ay; y <= by; y++) {
-					(*update) (this->prop [x][y]);
+					this->updateCell (update, x, y);
 				}
 			}
 		}
@@ -243,6 +254,7 @@ namespace Enki
 			int x, y, d, deltaE, deltaSE;
 			toIndex (center, cx, cy);
 			radius = this->scale (worldRadius);
+			this->allocateCells (cx - radius, cy - radius, cx + radius + 1, cy + radius + 1);
 			x = 0;
 			y = radius;
 			d = 1 - radius;
@@ -282,6 +294,7 @@ namespace Enki
 			int x, y, d, deltaE, deltaSE;
 			toIndex (center, cx, cy);
 			radius = this->scale (worldRadius);
+			this->allocateCells (cx - radius, cy - radius, cx + radius + 1, cy + radius + 1);
 			x = 0;
 			y = radius;
 			d = 1 - radius;
@@ -314,8 +327,28 @@ namespace Enki
 		 */
 		void drawPolygon (const T &value, const std::vector<Point> &polygon)
 		{
-			this->initEdgeTable (polygon);
-			int edgeTableSize = polygon.size ();
+			// the part of the polygon outside the grid is not drawn
+			std::vector<Point> clipped;
+			this->clipPolygon (polygon, clipped);
+			if (clipped.size () < 3) {
+				return ;
+			}
+			if (this->edges.size () < clipped.size ()) {
+				// value initialised edges are not linked
+				this->edges.resize (clipped.size ());
+			}
+			int xmin = this->size.x, ymin = this->size.y, xmax = 0, ymax = 0;
+			BOOST_FOREACH (const Point &vertex, clipped) {
+				int x, y;
+				this->toIndex (vertex, x, y);
+				xmin = std::min (xmin, x);
+				ymin = std::min (ymin, y);
+				xmax = std::max (xmax, x + 1);
+				ymax = std::max (ymax, y + 1);
+			}
+			this->allocateCells (xmin, ymin, xmax, ymax);
+			this->initEdgeTable (clipped);
+			int edgeTableSize = clipped.size ();
 			int y = 0;
 			while (this->edgeTable [y] == NULL_EDGE) {
 				y++;
@@ -331,6 +364,67 @@ namespace Enki
 			}
 		}
 	private:
+		/**
+		 * Clip the given polygon, in world coordinates, to the rectangle
+		 * spanned by the centres of the grid cells, with the
+		 * Sutherland-Hodgman algorithm.  The vertices of the result are in
+		 * the grid.
+		 */
+		void clipPolygon (const std::vector<Point> &polygon, std::vector<Point> &clipped) const
+		{
+			const double low [2] = {this->origin.x, this->origin.y};
+			const double high [2] = {
+				this->origin.x + (this->size.x - 1) * this->gridScale,
+				this->origin.y + (this->size.y - 1) * this->gridScale};
+			std::vector<Point> input;
+			clipped = polygon;
+			// left, right, bottom and top sides
+			for (int side = 0; side < 4 && !clipped.empty (); side++) {
+				const int axis = side / 2;
+				const bool upper = side % 2 == 1;
+				const double bound = upper ? high [axis] : low [axis];
+				input.swap (clipped);
+				clipped.clear ();
+				for (size_t i = 0; i < input.size (); i++) {
+					const Point &previous = input [i == 0 ? input.size () - 1 : i - 1];
+					const Point &current = input [i];
+					const double p = axis == 0 ? previous.x : previous.y;
+					const double c = axis == 0 ? current.x : current.y;
+					const bool previousInside = upper ? p <= bound : p >= bound;
+					const bool currentInside = upper ? c <= bound : c >= bound;
+					if (previousInside != currentInside) {
+						// the crossing lies exactly on the side
+						const double t = (bound - p) / (c - p);
+						Point crossing (previous.x + t * (current.x - previous.x), previous.y + t * (current.y - previous.y));
+						(axis == 0 ? crossing.x : crossing.y) = bound;
+						clipped.push_back (crossing);
+					}
+					if (currentInside) {
+						clipped.push_back (current);
+					}
+				}
+			}
+		}
+		/**
+		 * Set a cell to the given value.  Cells outside the grid are
+		 * ignored, so shapes may extend beyond the grid.
+		 */
+		inline void setCell (int x, int y, const T &value)
+		{
+			if (this->layout.contains (x, y)) {
+				this->prop [x][y] = value;
+			}
+		}
+		/**
+		 * Update a cell with the given function.  Cells outside the grid are
+		 * ignored.
+		 */
+		inline void updateCell (UpdateFunction update, int x, int y)
+		{
+			if (this->layout.contains (x, y)) {
+				(*update) (this->prop [x][y]);
+			}
+		}
 		/**
 		 * Draw circle points and do some filling.  Points are drawn taking
 		 * advantage of eight-way symmetry.  Since method {@code
@@ -342,14 +436,14 @@ namespace Enki
 		inline void circlePoints (const T &value, int cx, int cy, int x, int y)
 		{
 			for (int iy = cy - y, ly = cy + y; iy <= ly; iy++) {
-				this->prop [cx + x][iy] = value;
-				this->prop [cx - x][iy] = value;
+				this->setCell (cx + x, iy, value);
+				this->setCell (cx - x, iy, value);
 			}
 			if (x != y) {
-				this->prop [cx + y][cy + x] = value;
-				this->prop [cx + y][cy - x] = value;
-				this->prop [cx - y][cy + x] = value;
-				this->prop [cx - y][cy - x] = value;
+				this->setCell (cx + y, cy + x, value);
+				this->setCell (cx + y, cy - x, value);
+				this->setCell (cx - y, cy + x, value);
+				this->setCell (cx - y, cy - x, value);
 			}
 		}
 		/**
@@ -363,14 +457,14 @@ namespace Enki
 		inline void circlePoints (UpdateFunction update, int cx, int cy, int x, int y)
 		{
 			for (int iy = cy - y, ly = cy + y; iy <= ly; iy++) {
-				(*update) (this->prop [cx + x][iy]);
-				(*update) (this->prop [cx - x][iy]);
+				this->updateCell (update, cx + x, iy);
+				this->updateCell (update, cx - x, iy);
 			}
 			if (x != y) {
-				(*update) (this->prop [cx + y][cy + x]);
-				(*update) (this->prop [cx + y][cy - x]);
-				(*update) (this->prop [cx - y][cy + x]);
-				(*update) (this->prop [cx - y][cy - x]);
+				this->updateCell (update, cx + y, cy + x);
+				this->updateCell (update, cx + y, cy - x);
+				this->updateCell (update, cx - y, cy + x);
+				this->updateCell (update, cx - y, cy - x);
 			}
 		}
 		/**
@@ -1,10 +1,9 @@
 #ifndef __ABSTRACT_GRID_SIMULATION_H
 #define __ABSTRACT_GRID_SIMULATION_H
 
-#include <vector>
-
 #include "extensions/ExtendedWorld.h"
 #include "interactions/AbstractGrid.h"
+#include "interactions/GridField.h"
 
 namespace Enki
 {
@@ -21,9 +20,10 @@ namespace Enki
 	{
 	protected:
 		/**
-		 * Grid with the physical quantity.
+		 * Grid with the physical quantity.  Both planes use the layout of
+		 * field {@code AbstractGrid::layout}.
 		 */
-		std::vector<std::vector<T> > grid [2];
+		GridField<T> grid [2];
 		/**
 		 * Index of the current grid in field {@code grid}.
 		 */
@@ -32,21 +32,27 @@ namespace Enki
 		/**
 		 * This constructor should be used by a class that inherit multiple
 		 * times class {@code AbstractGrid}.
+		 *
+		 * @param touch whether the planes are initialised.  If false, the
+		 * subclass must write every element of both planes.
 		 */
-		AbstractGridSimulation ():
+		AbstractGridSimulation (bool touch = true):
 			AbstractGrid (NULL, -1, -1),
 			adtIndex (0)
 		{
-			this->initFields ();
+			this->initFields (touch);
 		}
 		/**
 		 * Construct a new grid.
+		 *
+		 * @param touch whether the planes are initialised.  If false, the
+		 * subclass must write every element of both planes.
 		 */
-		AbstractGridSimulation (const ExtendedWorld *world, double gridScale, double borderSize):
+		AbstractGridSimulation (const ExtendedWorld *world, double gridScale, double borderSize, bool touch = true):
 			AbstractGrid (world, gridScale, borderSize),
 			adtIndex (0)
 		{
-			this->initFields ();
+			this->initFields (touch);
 		}
 
 		virtual ~AbstractGridSimulation () {}
@@ -58,14 +64,10 @@ namespace Enki
 		 *
 		 * <p> With C++11 this would be in the most general constructor.
 		 */
-		void initFields ()
+		void initFields (bool touch)
 		{
-			this->grid [0].resize (this->size.x);
-			this->grid [1].resize (this->size.x);
-			for (int x = 0; x < this->size.x; x++) {
-				this->grid [0][x].resize (this->size.y);
-				this->grid [1][x].resize (this->size.y);
-			}
+			this->grid [0].resize (this->layout, touch);
+			this->grid [1].resize (this->layout, touch);
 		}
 	public:
 		/**
@@ -73,6 +75,7 @@ namespace Enki
 		 */
 		void fillGrid (T value)
 		{
+			this->allocateCells (0, 0, this->size.x, this->size.y);
 			for (int x = this->size.x - 1; x >= 0; x--) {
 				for (int y = this->size.y - 1; y >= 0; y--) {
 					this->grid [this->adtIndex][x][y] = value;
@@ -0,0 +1,339 @@
+#ifndef __GRID_FIELD_H
+#define __GRID_FIELD_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace Enki
+{
+	/**
+	 * Memory layout of a grid plane.  A plane is a single allocation
+	 * where the cells of column {@code x} are stored contiguously along
+	 * the vertical axis.  Consecutive columns are {@code stride} elements
+	 * apart.  The plane is surrounded by a halo ring of {@code halo} cells,
+	 * so that cells with coordinates between {@code -halo} and {@code
+	 * size+halo-1} can be addressed.
+
+	 * <p> The stride is expressed in elements and it does not depend on the
+	 * element type.  Every plane of a grid uses the same layout.  Hence the
+	 * linear index of a cell computed by method {@code index(int,int)} is
+	 * valid in the temperature plane and in the diffusivity plane.
+
+	 * <p> Columns are padded to a multiple of {@code LINE_ELEMENTS}
+	 * elements.  Together with an aligned allocation, the first halo cell
+	 * of every column starts on a cache line boundary.
+	 */
+	struct GridLayout
+	{
+		/**
+		 * Columns are padded to a multiple of this number of elements.
+		 * Sixteen elements are a cache line of floats, or two of doubles.
+		 */
+		static const int LINE_ELEMENTS = 16;
+		/**
+		 * Number of columns, excluding the halo.
+		 */
+		int sizeX;
+		/**
+		 * Number of cells in a column, excluding the halo.
+		 */
+		int sizeY;
+		/**
+		 * Width of the halo ring.
+		 */
+		int halo;
+		/**
+		 * Distance in elements between cell {@code (x,y)} and cell {@code
+		 * (x+1,y)}.
+		 */
+		int stride;
+		/**
+		 * Linear index of cell {@code (0,0)} from the start of the
+		 * allocation.
+		 */
+		std::ptrdiff_t offset;
+		/**
+		 * Total number of elements in the allocation, including halo and
+		 * padding.
+		 */
+		std::size_t count;
+
+		GridLayout ():
+			sizeX (0),
+			sizeY (0),
+			halo (0),
+			stride (0),
+			offset (0),
+			count (0)
+		{
+		}
+
+		GridLayout (int sizeX, int sizeY, int halo):
+			sizeX (sizeX),
+			sizeY (sizeY),
+			halo (halo),
+			stride (((sizeY + 2 * halo + LINE_ELEMENTS - 1) / LINE_ELEMENTS) * LINE_ELEMENTS),
+			offset ((std::ptrdiff_t) halo * stride + halo),
+			count ((std::size_t) (sizeX + 2 * halo) * stride)
+		{
+		}
+		/**
+		 * Return the linear index of cell {@code (x,y)} relative to cell
+		 * {@code (0,0)}.
+		 */
+		inline std::ptrdiff_t index (int x, int y) const
+		{
+			return (std::ptrdiff_t) x * this->stride + y;
+		}
+		/**
+		 * Check if the given cell is inside the grid, halo excluded.
+		 */
+		inline bool contains (int x, int y) const
+		{
+			return x >= 0 && x < this->sizeX && y >= 0 && y < this->sizeY;
+		}
+
+		bool operator== (const GridLayout &other) const
+		{
+			return this->sizeX == other.sizeX
+				&& this->sizeY == other.sizeY
+				&& this->halo == other.halo;
+		}
+	};
+
+	/**
+	 * A grid plane stored in a single aligned allocation with the layout
+	 * described by a {@code GridLayout} instance.
+
+	 * <p> The plane can be accessed as {@code field[x][y]}, as the former
+	 * vector of vectors, or through a pointer to cell {@code (0,0)} and the
+	 * layout stride.  Kernels should prefer the latter: neighbours of cell
+	 * {@code p} are {@code p[-1]}, {@code p[+1]}, {@code p[-stride]} and
+	 * {@code p[+stride]}.
+
+	 * <p> Small planes are aligned to a cache line.  Planes larger than a
+	 * huge page are aligned to a huge page and, on Linux, the kernel is
+	 * advised to back them with transparent huge pages.  Planes of sparse
+	 * grids are reserved instead, see method {@code reserve(const
+	 * GridLayout&)}.
+	 */
+	template<class T>
+	class GridField
+	{
+	public:
+		/**
+		 * Alignment of small allocations.
+		 */
+		static const std::size_t CACHE_LINE = 64;
+		/**
+		 * Alignment of allocations bigger than a huge page.
+		 */
+		static const std::size_t HUGE_PAGE = 2 * 1024 * 1024;
+	private:
+		GridLayout layout;
+		/**
+		 * Start of the allocation.
+		 */
+		T *memory;
+		/**
+		 * Cell {@code (0,0)}.
+		 */
+		T *origin;
+		/**
+		 * Size in bytes of the allocation if it is a memory mapping made by
+		 * method {@code reserve(const GridLayout&)}, zero otherwise.
+		 */
+		std::size_t mapped;
+
+		GridField (const GridField &);
+		GridField &operator= (const GridField &);
+	public:
+		GridField ():
+			memory (NULL),
+			origin (NULL),
+			mapped (0)
+		{
+		}
+
+		GridField (const GridLayout &layout):
+			memory (NULL),
+			origin (NULL),
+			mapped (0)
+		{
+			this->resize (layout);
+		}
+
+		~GridField ()
+		{
+			this->release ();
+		}
+		/**
+		 * Allocate the plane for the given layout.  Previous contents are
+		 * discarded and every element, halo included, is set to {@code
+		 * T()}.
+		 *
+		 * @param touch if false, elements are not initialised.  Memory pages
+		 * are then placed on the NUMA node of the thread that first writes
+		 * them, see method {@code fillColumns(int,int,const T&)}.
+		 */
+		void resize (const GridLayout &layout, bool touch = true)
+		{
+			this->release ();
+			this->layout = layout;
+			if (layout.count == 0) {
+				return ;
+			}
+			std::size_t bytes = layout.count * sizeof (T);
+			std::size_t alignment = bytes >= HUGE_PAGE ? HUGE_PAGE : CACHE_LINE;
+			bytes = ((bytes + alignment - 1) / alignment) * alignment;
+			void *block;
+			if (posix_memalign (&block, alignment, bytes) != 0) {
+				throw std::bad_alloc ();
+			}
+#if defined (__linux__) && defined (MADV_HUGEPAGE)
+			if (alignment == HUGE_PAGE) {
+				madvise (block, bytes, MADV_HUGEPAGE);
+			}
+#endif
+			this->memory = static_cast<T *> (block);
+			this->origin = this->memory + layout.offset;
+			if (touch) {
+				std::fill (this->memory, this->memory + layout.count, T ());
+			}
+		}
+
+		/**
+		 * Allocate the plane for the given layout without committing its
+		 * memory.  On Linux the plane is an anonymous mapping without huge
+		 * pages: a page is only committed when an element in it is first
+		 * written, and elements that were never written read zero.  A
+		 * sparse grid only commits the pages of the tiles it writes.
+		 * Elsewhere this is the same as method {@code resize(const
+		 * GridLayout&,bool)}.
+		 */
+		void reserve (const GridLayout &layout)
+		{
+#if defined (__linux__) && defined (MAP_ANONYMOUS)
+			this->release ();
+			this->layout = layout;
+			if (layout.count == 0) {
+				return ;
+			}
+			const std::size_t bytes = layout.count * sizeof (T);
+			void *block = mmap (NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if (block == MAP_FAILED) {
+				throw std::bad_alloc ();
+			}
+#ifdef MADV_NOHUGEPAGE
+			madvise (block, bytes, MADV_NOHUGEPAGE);
+#endif
+			this->memory = static_cast<T *> (block);
+			this->origin = this->memory + layout.offset;
+			this->mapped = bytes;
+#else
+			this->resize (layout);
+#endif
+		}
+
+		const GridLayout &getLayout () const
+		{
+			return this->layout;
+		}
+
+		int stride () const
+		{
+			return this->layout.stride;
+		}
+		/**
+		 * Return a pointer to cell {@code (0,0)}.
+		 */
+		T *data ()
+		{
+			return this->origin;
+		}
+
+		const T *data () const
+		{
+			return this->origin;
+		}
+		/**
+		 * Return a pointer to cell {@code (x,0)}.  This allows the plane to be
+		 * used as {@code field[x][y]}.
+		 */
+		T *operator[] (int x)
+		{
+			return this->origin + (std::ptrdiff_t) x * this->layout.stride;
+		}
+
+		const T *operator[] (int x) const
+		{
+			return this->origin + (std::ptrdiff_t) x * this->layout.stride;
+		}
+
+		T &at (int x, int y)
+		{
+			return this->origin [this->layout.index (x, y)];
+		}
+
+		const T &at (int x, int y) const
+		{
+			return this->origin [this->layout.index (x, y)];
+		}
+		/**
+		 * Set every element, halo included, to the given value.
+		 */
+		void fill (const T &value)
+		{
+			std::fill (this->memory, this->memory + this->layout.count, value);
+		}
+		/**
+		 * Set every element of columns {@code [xmin,xmax)}, including halo
+		 * and padding, to the given value.  Halo columns are addressed with
+		 * coordinates {@code -halo} and {@code sizeX+halo-1}.
+		 */
+		void fillColumns (int xmin, int xmax, const T &value)
+		{
+			std::fill (
+				this->origin + this->layout.index (xmin, -this->layout.halo),
+				this->origin + this->layout.index (xmax, -this->layout.halo),
+				value);
+		}
+		/**
+		 * Copy the contents of a plane with the same layout.
+		 */
+		void copy (const GridField &other)
+		{
+			std::copy (other.memory, other.memory + this->layout.count, this->memory);
+		}
+	private:
+		/**
+		 * Free the allocation, if any.
+		 */
+		void release ()
+		{
+#ifdef __linux__
+			if (this->mapped != 0) {
+				munmap (this->memory, this->mapped);
+				this->memory = NULL;
+			}
+#endif
+			free (this->memory);
+			this->memory = NULL;
+			this->origin = NULL;
+			this->mapped = 0;
+		}
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,33 @@
+#include <algorithm>
+
+#include "GridTiling.h"
+
+using namespace Enki;
+
+int GridTiling::TILE_WIDTH = 32;
+int GridTiling::TILE_HEIGHT = 64;
+
+void GridTiling::
+init (int xmin, int ymin, int xmax, int ymax, int tileWidth, int tileHeight)
+{
+	tileWidth = std::max (1, tileWidth);
+	tileHeight = std::max (1, tileHeight);
+	this->xmin = xmin;
+	this->ymin = ymin;
+	this->tileWidth = tileWidth;
+	this->tileHeight = tileHeight;
+	this->columns = std::max (0, (xmax - xmin + tileWidth - 1) / tileWidth);
+	this->rows = std::max (0, (ymax - ymin + tileHeight - 1) / tileHeight);
+	this->tiles.clear ();
+	this->tiles.reserve (this->columns * this->rows);
+	for (int column = 0; column < this->columns; column++) {
+		for (int row = 0; row < this->rows; row++) {
+			GridTile tile;
+			tile.xmin = xmin + column * tileWidth;
+			tile.xmax = std::min (xmax, tile.xmin + tileWidth);
+			tile.ymin = ymin + row * tileHeight;
+			tile.ymax = std::min (ymax, tile.ymin + tileHeight);
+			this->tiles.push_back (tile);
+		}
+	}
+}
@@ -0,0 +1,131 @@
+#ifndef __GRID_TILING_H
+#define __GRID_TILING_H
+
+#include <vector>
+#include <algorithm>
+
+namespace Enki
+{
+	/**
+	 * A rectangular block of grid cells, {@code [xmin,xmax)} by {@code
+	 * [ymin,ymax)}.
+	 */
+	struct GridTile
+	{
+		int xmin;
+		int ymin;
+		int xmax;
+		int ymax;
+	};
+
+	/**
+	 * Range of cells {@code [ymin,ymax)} of a grid column.  The range is
+	 * empty if {@code ymin >= ymax}.
+	 */
+	struct GridSpan
+	{
+		int ymin;
+		int ymax;
+	};
+
+	/**
+	 * Division of the cells of a grid that are updated in rectangular
+	 * tiles.  Tiles are numbered column major: tile {@code i} is in tile
+	 * column {@code i / rows} and tile row {@code i % rows}.  Consecutive
+	 * tiles are vertically adjacent, which follows the memory layout of
+	 * grid planes.
+
+	 * <p> Tiles on the right and upper edges may be smaller than the
+	 * requested tile size.
+	 */
+	class GridTiling
+	{
+		std::vector<GridTile> tiles;
+		/**
+		 * Number of tile columns.
+		 */
+		int columns;
+		/**
+		 * Number of tile rows.
+		 */
+		int rows;
+		/**
+		 * Lower left corner of tile zero.
+		 */
+		int xmin;
+		int ymin;
+		int tileWidth;
+		int tileHeight;
+	public:
+		/**
+		 * Default tile width, number of grid columns in a tile.
+		 */
+		static /*const*/ int TILE_WIDTH;
+		/**
+		 * Default tile height, number of grid cells of a column in a tile.
+		 */
+		static /*const*/ int TILE_HEIGHT;
+
+		GridTiling ():
+			columns (0),
+			rows (0),
+			xmin (0),
+			ymin (0),
+			tileWidth (1),
+			tileHeight (1)
+		{
+		}
+		/**
+		 * Divide the cells {@code [xmin,xmax)} by {@code [ymin,ymax)} in
+		 * tiles with the given size.
+		 */
+		void init (int xmin, int ymin, int xmax, int ymax, int tileWidth, int tileHeight);
+
+		int size () const
+		{
+			return this->tiles.size ();
+		}
+
+		int getColumns () const
+		{
+			return this->columns;
+		}
+
+		int getRows () const
+		{
+			return this->rows;
+		}
+
+		const GridTile &operator[] (int index) const
+		{
+			return this->tiles [index];
+		}
+		/**
+		 * Return the index of the tile that contains the given cell.  Cells
+		 * outside the tiles, such as border cells, belong to the closest
+		 * tile.
+		 */
+		int tileAt (int x, int y) const
+		{
+			const int column = std::max (0, std::min (this->columns - 1, (x - this->xmin) / this->tileWidth));
+			const int row = std::max (0, std::min (this->rows - 1, (y - this->ymin) / this->tileHeight));
+			return column * this->rows + row;
+		}
+		/**
+		 * Return the smallest side of the tiles, ignoring smaller tiles on
+		 * the edges.
+		 */
+		int minimumSide () const
+		{
+			return std::min (this->tileWidth, this->tileHeight);
+		}
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
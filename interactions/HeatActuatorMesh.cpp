@@ -55,18 +55,8 @@ HeatActuatorMesh::~HeatActuatorMesh ()
 	// delete this->shape;
 }
 
-#include <iostream>
-
-void HeatActuatorMesh::
-step (double dt, PhysicSimulation *ps)
+const std::vector<Point> &HeatActuatorMesh::
+getPoints () const
 {
-	WorldHeat *worldHeat = dynamic_cast<WorldHeat *> (ps);
-	if (worldHeat != NULL) {
-		if (this->switchedOn) {
-			double value = this->getRealHeat (dt, worldHeat);
-			for (int i = this->mesh->size () - 1; i >= 0; i--) {
-				worldHeat->setHeatAt (this->absolutePosition + (*(this->mesh)) [i], value);
-			}
-		}
-	}
+	return this->mesh->points;
 }
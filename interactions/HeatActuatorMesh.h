@@ -32,6 +32,8 @@ namespace Enki
 		 * The points that compose the heat source of this actuator.
 		 */
 		const PointMesh *mesh;
+	protected:
+		virtual const std::vector<Point> &getPoints () const;
 	public:
 		/**
 		 * Create a circular heat source with the given radius.  The mesh is composed of {@code numberPoints} randomly created.
@@ -67,7 +69,6 @@ namespace Enki
 			int numberPoints);
 		HeatActuatorMesh(const HeatActuatorMesh& orig);
 		virtual ~HeatActuatorMesh();
-		virtual void step (double dt, PhysicSimulation* w);
 	private:
 
 	};
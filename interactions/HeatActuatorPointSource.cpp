@@ -1,9 +1,15 @@
+#include <cmath>
 #include <iostream>
 
 #include "HeatActuatorPointSource.h"
 
 using namespace Enki;
 
+/**
+ * The single point of a point source.
+ */
+static const std::vector<Point> POINT_SOURCE (1, Point (0, 0));
+
 HeatActuatorPointSource::HeatActuatorPointSource
 	(Robot* owner, Vector relativePosition,
 	 double thermalResponseTime,
@@ -14,11 +20,42 @@ HeatActuatorPointSource::HeatActuatorPointSource
 	heat (ambientTemperature),
 	thermalResponseTime (thermalResponseTime),
 	switchedOn (false),
-	recomputeHeatDistribution (false)
+	recomputeHeatDistribution (false),
+	stampHeat (NULL),
+	imposed (false),
+	imposedHeat (0)
 {
 	Component::init ();
 }
 
+HeatActuatorPointSource::
+HeatActuatorPointSource (const HeatActuatorPointSource &orig):
+	PhysicInteraction (orig),
+	Component (orig),
+	heat (orig.heat),
+	thermalResponseTime (orig.thermalResponseTime),
+	switchedOn (orig.switchedOn),
+	recomputeHeatDistribution (orig.recomputeHeatDistribution),
+	stampHeat (NULL),
+	imposed (false),
+	imposedHeat (0)
+{
+}
+
+HeatActuatorPointSource::
+~HeatActuatorPointSource ()
+{
+	if (this->imposed) {
+		this->stampHeat->clearFixedHeat (this);
+	}
+}
+
+const std::vector<Point> &HeatActuatorPointSource::
+getPoints () const
+{
+	return POINT_SOURCE;
+}
+
 
 void HeatActuatorPointSource::
 init (double dt, PhysicSimulation *ps)
@@ -51,13 +88,39 @@ step (double dt, PhysicSimulation *ps)
 {
 	WorldHeat *worldHeat = dynamic_cast<WorldHeat *> (ps);
 	if (worldHeat != NULL) {
+		this->checkHeatDistribution (worldHeat);
+		if (this->stampHeat != worldHeat
+			 || this->stampPosition.x != this->absolutePosition.x
+			 || this->stampPosition.y != this->absolutePosition.y) {
+			if (this->imposed) {
+				this->stampHeat->clearFixedHeat (this);
+			}
+			this->imposed = false;
+			worldHeat->stampCells (this->absolutePosition, this->getPoints (), this->stamp);
+			this->stampPosition = this->absolutePosition;
+			this->stampHeat = worldHeat;
+		}
 		if (this->switchedOn) {
-			worldHeat->setHeatAt (this->absolutePosition, this->getRealHeat (dt, worldHeat));
+			const double value = this->getRealHeat (dt, worldHeat);
+			if (!this->imposed || fabs (value - this->imposedHeat) > WorldHeat::FROZEN_WRITE_TOLERANCE) {
+				worldHeat->setFixedHeat (this, this->stamp, value);
+				this->imposed = true;
+				this->imposedHeat = value;
+			}
 		}
-		if (this->recomputeHeatDistribution) {
-			this->recomputeHeatDistribution = false;
-			worldHeat->computeHeatDistribution ();
-			std::cout << "Forcing computation of steady state\n";
+		else if (this->imposed) {
+			worldHeat->clearFixedHeat (this);
+			this->imposed = false;
 		}
 	}
 }
+
+void HeatActuatorPointSource::
+checkHeatDistribution (WorldHeat *worldHeat)
+{
+	if (this->recomputeHeatDistribution) {
+		this->recomputeHeatDistribution = false;
+		worldHeat->computeHeatDistribution ();
+		std::cout << "Forcing computation of steady state\n";
+	}
+}
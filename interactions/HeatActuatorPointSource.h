@@ -4,6 +4,8 @@
 #include <enki/PhysicalEngine.h>
 #include <enki/Geometry.h>
 
+#include <vector>
+
 #include "extensions/Component.h"
 #include "extensions/PhysicInteraction.h"
 
@@ -14,6 +16,13 @@ namespace Enki
 	/**
 	 * Represents a heat point source.  The source is relative to the robot
 	 * that owns this actuator as specified by class {@code Component}.
+	 *
+	 * <p> The cells under the actuator are fixed at its temperature in the
+	 * heat model, which keeps them at that temperature during the grid
+	 * update.  The actuator only changes them when it moves, is switched,
+	 * or when its temperature changes by more than {@code
+	 * WorldHeat::FROZEN_WRITE_TOLERANCE}, and releases them when it is
+	 * destroyed.
 	 */
 	class HeatActuatorPointSource :
 		public PhysicInteraction,
@@ -36,6 +45,22 @@ namespace Enki
 		 * Whether we should recompute the heat distribution in the world.
 		 */
 		bool recomputeHeatDistribution;
+		/**
+		 * Offsets of the grid cells under the actuator, computed by {@code
+		 * WorldHeat::stampCells} when the actuator was last moved.
+		 */
+		std::vector<std::ptrdiff_t> stamp;
+		/**
+		 * Position of the actuator and heat model of the stamp.
+		 */
+		Enki::Vector stampPosition;
+		WorldHeat *stampHeat;
+		/**
+		 * Whether the stamp cells are fixed in the heat model, and their
+		 * temperature.
+		 */
+		bool imposed;
+		double imposedHeat;
 		/**
 		 * Return the real heat that this actuator is able to produce.
 		 */
@@ -46,12 +71,26 @@ namespace Enki
 				factor * this->heat
 				+ (1 - factor) * worldHeat->getHeatAt (this->absolutePosition);
 		}
+		/**
+		 * If the setpoint or the state of this actuator changed, tell the
+		 * heat model to recompute the heat distribution.
+		 */
+		void checkHeatDistribution (WorldHeat *worldHeat);
+		/**
+		 * Return the points of this actuator, relative to its position.
+		 */
+		virtual const std::vector<Point> &getPoints () const;
 	public:
 		HeatActuatorPointSource (
 			Enki::Robot* owner,
 			Enki::Vector relativePosition,
 			double thermalResponseTime,
 			double ambientTemperature);
+		HeatActuatorPointSource (const HeatActuatorPointSource &orig);
+		/**
+		 * Release the cells fixed by this actuator.
+		 */
+		virtual ~HeatActuatorPointSource ();
 		void setHeat (double value);
         double getHeat(void) { return this->heat; }
 		bool isSwitchedOn () const
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+
+#include "HeatAdi.h"
+
+using namespace Enki;
+
+void HeatAdi::
+solveColumns (
+	const HeatValue *heat, const HeatValue *east, const HeatValue *north, const HeatValue *fixed, HeatValue *half, HeatValue *scratch,
+	const GridSpan *spans, std::ptrdiff_t stride, int sizeY, int xmin, int xmax,
+	double normalHeat, double loss)
+{
+	const double source = loss * normalHeat;
+	for (int x = xmin; x < xmax; x++) {
+		const int first = spans [x].ymin;
+		const int last = spans [x].ymax - 1;
+		const HeatValue *h = heat + x * stride;
+		const HeatValue *e = east + x * stride;
+		const HeatValue *w = e - stride;
+		const HeatValue *v = north + x * stride;
+		const HeatValue *f = fixed != NULL ? fixed + x * stride : NULL;
+		HeatValue *s = half + x * stride;
+		HeatValue *c = scratch + x * stride;
+		// inactive cells are copied
+		if (last < first) {
+			std::copy (h, h + sizeY, s);
+			continue;
+		}
+		std::copy (h, h + first, s);
+		std::copy (h + last + 1, h + sizeY, s + last + 1);
+		// forward elimination
+		double previousC = 0;
+		double previousD = 0;
+		for (int y = first; y <= last; y++) {
+			if (f != NULL && !std::isnan (f [y])) {
+				// a fixed cell splits the line
+				previousC = c [y] = 0;
+				previousD = s [y] = f [y];
+				continue;
+			}
+			const double currentHeat = h [y];
+			double rhs =
+				currentHeat
+				+ (h [y + stride] - currentHeat) * e [y]
+				+ (h [y - stride] - currentHeat) * w [y]
+				+ (normalHeat - currentHeat) * loss
+				+ source;
+			double lower = -v [y - 1];
+			double upper = -v [y];
+			const double diagonal = 1 + v [y - 1] + v [y] + loss;
+			if (y == first) {
+				rhs -= lower * h [first - 1];
+				lower = 0;
+			}
+			if (y == last) {
+				rhs -= upper * h [last + 1];
+				upper = 0;
+			}
+			const double m = diagonal - lower * previousC;
+			previousC = c [y] = upper / m;
+			previousD = s [y] = (rhs - lower * previousD) / m;
+		}
+		// back substitution
+		for (int y = last - 1; y >= first; y--) {
+			s [y] -= c [y] * s [y + 1];
+		}
+	}
+}
+
+void HeatAdi::
+solveRows (
+	const HeatValue *half, const HeatValue *east, const HeatValue *north, const HeatValue *fixed, HeatValue *next, HeatValue *scratch,
+	const GridSpan *spans, std::ptrdiff_t stride, int sizeX, int ymin, int ymax,
+	double normalHeat, double loss)
+{
+	const double source = loss * normalHeat;
+	const int last = sizeX - 2;
+	// forward elimination
+	for (int x = 1; x <= last; x++) {
+		const HeatValue *s = half + x * stride;
+		const HeatValue *e = east + x * stride;
+		const HeatValue *w = e - stride;
+		const HeatValue *v = north + x * stride;
+		const HeatValue *f = fixed != NULL ? fixed + x * stride : NULL;
+		HeatValue *n = next + x * stride;
+		HeatValue *c = scratch + x * stride;
+		const GridSpan &span = spans [x];
+		for (int y = ymin; y < ymax; y++) {
+			if (y < span.ymin || y >= span.ymax) {
+				// inactive cells have an identity equation
+				c [y] = 0;
+				n [y] = s [y];
+				continue;
+			}
+			if (f != NULL && !std::isnan (f [y])) {
+				// a fixed cell splits the line
+				c [y] = 0;
+				n [y] = f [y];
+				continue;
+			}
+			const double currentHeat = s [y];
+			double rhs =
+				currentHeat
+				+ (s [y + 1] - currentHeat) * v [y]
+				+ (s [y - 1] - currentHeat) * v [y - 1]
+				+ (normalHeat - currentHeat) * loss
+				+ source;
+			double lower = -w [y];
+			double upper = -e [y];
+			const double diagonal = 1 + w [y] + e [y] + loss;
+			double previousC = 0;
+			double previousD = 0;
+			if (x == 1) {
+				rhs -= lower * s [y - stride];
+				lower = 0;
+			}
+			else {
+				previousC = c [y - stride];
+				previousD = n [y - stride];
+			}
+			if (x == last) {
+				rhs -= upper * s [y + stride];
+				upper = 0;
+			}
+			const double m = diagonal - lower * previousC;
+			c [y] = upper / m;
+			n [y] = (rhs - lower * previousD) / m;
+		}
+	}
+	// back substitution
+	for (int x = last - 1; x >= 1; x--) {
+		const HeatValue *c = scratch + x * stride;
+		HeatValue *n = next + x * stride;
+		const HeatValue *n1 = n + stride;
+		for (int y = ymin; y < ymax; y++) {
+			n [y] -= c [y] * n1 [y];
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef __HEAT_ADI_H
+#define __HEAT_ADI_H
+
+#include <cstddef>
+
+#include "HeatKernels.h"
+#include "GridTiling.h"
+
+namespace Enki
+{
+	/**
+	 * Line solvers of the Peaceman-Rachford alternating direction implicit
+	 * method for the heat equation of {@code WorldHeat}.  The discrete
+	 * operator is split in a vertical part and a horizontal part, and the
+	 * cell dissipation is split in halves between them.  A time step of
+	 * length {@code dt} is made of two half steps:
+
+	 * <ol>
+	 * <li> vertical lines are implicit, horizontal neighbours are explicit;
+	 * <li> horizontal lines are implicit, vertical neighbours are explicit.
+	 * </ol>
+
+	 * <p> Each half step solves a tridiagonal system per line with the
+	 * Thomas algorithm.  The systems are diagonally dominant, so the method
+	 * is stable for any time step.  Border cells and the cells outside the
+	 * active spans of {@code spans}, indexed by column, are not updated and
+	 * are used as fixed temperature boundary conditions.  So are the cells
+	 * of plane {@code fixed} that are not NaN, which split the lines they
+	 * belong to.  Plane {@code fixed} may be {@code NULL}.
+
+	 * <p> Pointers point to cell {@code (0,0)} of planes that share the
+	 * same {@code GridLayout}.  Planes {@code east} and {@code north} are
+	 * face conductances as in {@code HeatKernels}, multiplied by half the
+	 * time step and the partial alpha of {@code WorldHeat}.  Parameter
+	 * {@code loss} is the conductance to the outside world of one half
+	 * step, so it includes half of the cell dissipation.  Plane {@code
+	 * scratch} holds the modified upper diagonal of the Thomas algorithm.
+	 * Lines solved by different threads use disjoint parts of the scratch
+	 * plane.
+
+	 * <p> The lines are solved in double precision whatever the type of
+	 * the planes.
+	 */
+	class HeatAdi
+	{
+	public:
+		/**
+		 * First half step.  Solve the vertical lines of columns {@code
+		 * [xmin,xmax)} and write the result in {@code half}.  Inactive cells
+		 * of these columns are copied from {@code heat}.
+		 */
+		static void solveColumns (
+			const HeatValue *heat, const HeatValue *east, const HeatValue *north, const HeatValue *fixed, HeatValue *half, HeatValue *scratch,
+			const GridSpan *spans, std::ptrdiff_t stride, int sizeY, int xmin, int xmax,
+			double normalHeat, double loss);
+		/**
+		 * Second half step.  Solve the horizontal lines of rows {@code
+		 * [ymin,ymax)} and write the result in {@code next}.  Inactive cells
+		 * of these rows are copied from {@code half}, border columns of
+		 * {@code half} and {@code next} must hold the same values.  The
+		 * lines are solved together, so that the inner loops run along
+		 * contiguous cells.
+		 */
+		static void solveRows (
+			const HeatValue *half, const HeatValue *east, const HeatValue *north, const HeatValue *fixed, HeatValue *next, HeatValue *scratch,
+			const GridSpan *spans, std::ptrdiff_t stride, int sizeX, int ymin, int ymax,
+			double normalHeat, double loss);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
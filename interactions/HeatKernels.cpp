@@ -0,0 +1,420 @@
+#include <iostream>
+
+#include "HeatKernels.h"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HEAT_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace Enki;
+
+/*
+ * This file must be compiled without floating point contraction.  Fusing
+ * a multiplication and an addition changes the rounding and the vector
+ * kernels would no longer match the scalar kernel.
+ */
+
+void HeatKernels::
+scalar (
+	const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	const HeatValue normal = normalHeat;
+	const HeatValue l = loss;
+	for (int x = xmin; x < xmax; x++) {
+		const HeatValue *h = heat + x * stride;
+		const HeatValue *e = east + x * stride;
+		const HeatValue *w = e - stride;
+		const HeatValue *c = north + x * stride;
+		HeatValue *n = nextHeat + x * stride;
+		for (int y = ymin; y < ymax; y++) {
+			const HeatValue currentHeat = h [y];
+			const HeatValue deltaHeat =
+				+ (h [y + 1] - currentHeat) * c [y]
+				+ (h [y - 1] - currentHeat) * c [y - 1]
+				+ (h [y + stride] - currentHeat) * e [y]
+				+ (h [y - stride] - currentHeat) * w [y]
+				+ (normal - currentHeat) * l
+				;
+			n [y] = currentHeat + deltaHeat;
+		}
+	}
+}
+
+void HeatKernels::
+uniformScalar (
+	const HeatValue *heat, double conductance, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	const HeatValue k = conductance;
+	const HeatValue normal = normalHeat;
+	const HeatValue l = loss;
+	for (int x = xmin; x < xmax; x++) {
+		const HeatValue *h = heat + x * stride;
+		HeatValue *n = nextHeat + x * stride;
+		for (int y = ymin; y < ymax; y++) {
+			const HeatValue currentHeat = h [y];
+			const HeatValue deltaHeat =
+				+ (h [y + 1] - currentHeat) * k
+				+ (h [y - 1] - currentHeat) * k
+				+ (h [y + stride] - currentHeat) * k
+				+ (h [y - stride] - currentHeat) * k
+				+ (normal - currentHeat) * l
+				;
+			n [y] = currentHeat + deltaHeat;
+		}
+	}
+}
+
+#ifdef HEAT_KERNELS_X86
+
+/*
+ * Vector operations on heat values.  The kernels are written once with
+ * these functions, which select the single or double precision
+ * instructions at compile time.
+ */
+
+#ifdef WORLDHEAT_FLOAT
+typedef __m256 Avx2Vector;
+typedef __m512 Avx512Vector;
+#else
+typedef __m256d Avx2Vector;
+typedef __m512d Avx512Vector;
+#endif
+
+static const int AVX2_LANES = 32 / sizeof (HeatValue);
+static const int AVX512_LANES = 64 / sizeof (HeatValue);
+
+__attribute__ ((target ("avx2")))
+static inline Avx2Vector avx2Set (HeatValue value)
+{
+#ifdef WORLDHEAT_FLOAT
+	return _mm256_set1_ps (value);
+#else
+	return _mm256_set1_pd (value);
+#endif
+}
+
+__attribute__ ((target ("avx2")))
+static inline Avx2Vector avx2Load (const HeatValue *p)
+{
+#ifdef WORLDHEAT_FLOAT
+	return _mm256_loadu_ps (p);
+#else
+	return _mm256_loadu_pd (p);
+#endif
+}
+
+__attribute__ ((target ("avx2")))
+static inline void avx2Store (HeatValue *p, Avx2Vector v)
+{
+#ifdef WORLDHEAT_FLOAT
+	_mm256_storeu_ps (p, v);
+#else
+	_mm256_storeu_pd (p, v);
+#endif
+}
+
+/**
+ * Return {@code (a - b) * c}.
+ */
+__attribute__ ((target ("avx2")))
+static inline Avx2Vector avx2Flux (Avx2Vector a, Avx2Vector b, Avx2Vector c)
+{
+#ifdef WORLDHEAT_FLOAT
+	return _mm256_mul_ps (_mm256_sub_ps (a, b), c);
+#else
+	return _mm256_mul_pd (_mm256_sub_pd (a, b), c);
+#endif
+}
+
+__attribute__ ((target ("avx2")))
+static inline Avx2Vector avx2Add (Avx2Vector a, Avx2Vector b)
+{
+#ifdef WORLDHEAT_FLOAT
+	return _mm256_add_ps (a, b);
+#else
+	return _mm256_add_pd (a, b);
+#endif
+}
+
+__attribute__ ((target ("avx512f")))
+static inline Avx512Vector avx512Set (HeatValue value)
+{
+#ifdef WORLDHEAT_FLOAT
+	return _mm512_set1_ps (value);
+#else
+	return _mm512_set1_pd (value);
+#endif
+}
+
+__attribute__ ((target ("avx512f")))
+static inline Avx512Vector avx512Load (const HeatValue *p)
+{
+#ifdef WORLDHEAT_FLOAT
+	return _mm512_loadu_ps (p);
+#else
+	return _mm512_loadu_pd (p);
+#endif
+}
+
+__attribute__ ((target ("avx512f")))
+static inline void avx512Store (HeatValue *p, Avx512Vector v)
+{
+#ifdef WORLDHEAT_FLOAT
+	_mm512_storeu_ps (p, v);
+#else
+	_mm512_storeu_pd (p, v);
+#endif
+}
+
+__attribute__ ((target ("avx512f")))
+static inline Avx512Vector avx512Flux (Avx512Vector a, Avx512Vector b, Avx512Vector c)
+{
+#ifdef WORLDHEAT_FLOAT
+	return _mm512_mul_ps (_mm512_sub_ps (a, b), c);
+#else
+	return _mm512_mul_pd (_mm512_sub_pd (a, b), c);
+#endif
+}
+
+__attribute__ ((target ("avx512f")))
+static inline Avx512Vector avx512Add (Avx512Vector a, Avx512Vector b)
+{
+#ifdef WORLDHEAT_FLOAT
+	return _mm512_add_ps (a, b);
+#else
+	return _mm512_add_pd (a, b);
+#endif
+}
+
+__attribute__ ((target ("avx2")))
+void HeatKernels::
+avx2 (
+	const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	const Avx2Vector vNormalHeat = avx2Set (normalHeat);
+	const Avx2Vector vLoss = avx2Set (loss);
+	for (int x = xmin; x < xmax; x++) {
+		const HeatValue *h = heat + x * stride;
+		const HeatValue *e = east + x * stride;
+		const HeatValue *w = e - stride;
+		const HeatValue *c = north + x * stride;
+		HeatValue *n = nextHeat + x * stride;
+		int y = ymin;
+		for (; y + AVX2_LANES <= ymax; y += AVX2_LANES) {
+			const Avx2Vector currentHeat = avx2Load (h + y);
+			Avx2Vector sum = avx2Flux (avx2Load (h + y + 1), currentHeat, avx2Load (c + y));
+			sum = avx2Add (sum, avx2Flux (avx2Load (h + y - 1), currentHeat, avx2Load (c + y - 1)));
+			sum = avx2Add (sum, avx2Flux (avx2Load (h + y + stride), currentHeat, avx2Load (e + y)));
+			sum = avx2Add (sum, avx2Flux (avx2Load (h + y - stride), currentHeat, avx2Load (w + y)));
+			sum = avx2Add (sum, avx2Flux (vNormalHeat, currentHeat, vLoss));
+			avx2Store (n + y, avx2Add (currentHeat, sum));
+		}
+		if (y < ymax) {
+			HeatKernels::scalar (heat, east, north, nextHeat, stride, x, y, x + 1, ymax, normalHeat, loss);
+		}
+	}
+}
+
+__attribute__ ((target ("avx512f")))
+void HeatKernels::
+avx512 (
+	const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	const Avx512Vector vNormalHeat = avx512Set (normalHeat);
+	const Avx512Vector vLoss = avx512Set (loss);
+	for (int x = xmin; x < xmax; x++) {
+		const HeatValue *h = heat + x * stride;
+		const HeatValue *e = east + x * stride;
+		const HeatValue *w = e - stride;
+		const HeatValue *c = north + x * stride;
+		HeatValue *n = nextHeat + x * stride;
+		int y = ymin;
+		for (; y + AVX512_LANES <= ymax; y += AVX512_LANES) {
+			const Avx512Vector currentHeat = avx512Load (h + y);
+			Avx512Vector sum = avx512Flux (avx512Load (h + y + 1), currentHeat, avx512Load (c + y));
+			sum = avx512Add (sum, avx512Flux (avx512Load (h + y - 1), currentHeat, avx512Load (c + y - 1)));
+			sum = avx512Add (sum, avx512Flux (avx512Load (h + y + stride), currentHeat, avx512Load (e + y)));
+			sum = avx512Add (sum, avx512Flux (avx512Load (h + y - stride), currentHeat, avx512Load (w + y)));
+			sum = avx512Add (sum, avx512Flux (vNormalHeat, currentHeat, vLoss));
+			avx512Store (n + y, avx512Add (currentHeat, sum));
+		}
+		if (y < ymax) {
+			HeatKernels::avx2 (heat, east, north, nextHeat, stride, x, y, x + 1, ymax, normalHeat, loss);
+		}
+	}
+}
+
+__attribute__ ((target ("avx2")))
+void HeatKernels::
+uniformAvx2 (
+	const HeatValue *heat, double conductance, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	const Avx2Vector vConductance = avx2Set (conductance);
+	const Avx2Vector vNormalHeat = avx2Set (normalHeat);
+	const Avx2Vector vLoss = avx2Set (loss);
+	for (int x = xmin; x < xmax; x++) {
+		const HeatValue *h = heat + x * stride;
+		HeatValue *n = nextHeat + x * stride;
+		int y = ymin;
+		for (; y + AVX2_LANES <= ymax; y += AVX2_LANES) {
+			const Avx2Vector currentHeat = avx2Load (h + y);
+			Avx2Vector sum = avx2Flux (avx2Load (h + y + 1), currentHeat, vConductance);
+			sum = avx2Add (sum, avx2Flux (avx2Load (h + y - 1), currentHeat, vConductance));
+			sum = avx2Add (sum, avx2Flux (avx2Load (h + y + stride), currentHeat, vConductance));
+			sum = avx2Add (sum, avx2Flux (avx2Load (h + y - stride), currentHeat, vConductance));
+			sum = avx2Add (sum, avx2Flux (vNormalHeat, currentHeat, vLoss));
+			avx2Store (n + y, avx2Add (currentHeat, sum));
+		}
+		if (y < ymax) {
+			HeatKernels::uniformScalar (heat, conductance, nextHeat, stride, x, y, x + 1, ymax, normalHeat, loss);
+		}
+	}
+}
+
+__attribute__ ((target ("avx512f")))
+void HeatKernels::
+uniformAvx512 (
+	const HeatValue *heat, double conductance, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	const Avx512Vector vConductance = avx512Set (conductance);
+	const Avx512Vector vNormalHeat = avx512Set (normalHeat);
+	const Avx512Vector vLoss = avx512Set (loss);
+	for (int x = xmin; x < xmax; x++) {
+		const HeatValue *h = heat + x * stride;
+		HeatValue *n = nextHeat + x * stride;
+		int y = ymin;
+		for (; y + AVX512_LANES <= ymax; y += AVX512_LANES) {
+			const Avx512Vector currentHeat = avx512Load (h + y);
+			Avx512Vector sum = avx512Flux (avx512Load (h + y + 1), currentHeat, vConductance);
+			sum = avx512Add (sum, avx512Flux (avx512Load (h + y - 1), currentHeat, vConductance));
+			sum = avx512Add (sum, avx512Flux (avx512Load (h + y + stride), currentHeat, vConductance));
+			sum = avx512Add (sum, avx512Flux (avx512Load (h + y - stride), currentHeat, vConductance));
+			sum = avx512Add (sum, avx512Flux (vNormalHeat, currentHeat, vLoss));
+			avx512Store (n + y, avx512Add (currentHeat, sum));
+		}
+		if (y < ymax) {
+			HeatKernels::uniformAvx2 (heat, conductance, nextHeat, stride, x, y, x + 1, ymax, normalHeat, loss);
+		}
+	}
+}
+
+bool HeatKernels::
+supported (const std::string &name)
+{
+	__builtin_cpu_init ();
+	if (name == "avx2") {
+		return __builtin_cpu_supports ("avx2");
+	}
+	else if (name == "avx512") {
+		return __builtin_cpu_supports ("avx512f");
+	}
+	return name == "scalar";
+}
+
+#else
+
+void HeatKernels::
+avx2 (
+	const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	HeatKernels::scalar (heat, east, north, nextHeat, stride, xmin, ymin, xmax, ymax, normalHeat, loss);
+}
+
+void HeatKernels::
+avx512 (
+	const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	HeatKernels::scalar (heat, east, north, nextHeat, stride, xmin, ymin, xmax, ymax, normalHeat, loss);
+}
+
+void HeatKernels::
+uniformAvx2 (
+	const HeatValue *heat, double conductance, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	HeatKernels::uniformScalar (heat, conductance, nextHeat, stride, xmin, ymin, xmax, ymax, normalHeat, loss);
+}
+
+void HeatKernels::
+uniformAvx512 (
+	const HeatValue *heat, double conductance, HeatValue *nextHeat,
+	std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+	double normalHeat, double loss)
+{
+	HeatKernels::uniformScalar (heat, conductance, nextHeat, stride, xmin, ymin, xmax, ymax, normalHeat, loss);
+}
+
+bool HeatKernels::
+supported (const std::string &name)
+{
+	return name == "scalar";
+}
+
+#endif
+
+HeatKernels::Function HeatKernels::
+select (const std::string &name)
+{
+	if (name == "auto") {
+		if (HeatKernels::supported ("avx512")) {
+			return HeatKernels::avx512;
+		}
+		if (HeatKernels::supported ("avx2")) {
+			return HeatKernels::avx2;
+		}
+		return HeatKernels::scalar;
+	}
+	if (!HeatKernels::supported (name)) {
+		std::cerr << "Heat kernel " << name << " is not supported, using scalar kernel\n";
+		return HeatKernels::scalar;
+	}
+	if (name == "avx512") {
+		return HeatKernels::avx512;
+	}
+	if (name == "avx2") {
+		return HeatKernels::avx2;
+	}
+	return HeatKernels::scalar;
+}
+
+const char *HeatKernels::
+name (Function kernel)
+{
+	if (kernel == HeatKernels::avx512) {
+		return "avx512";
+	}
+	if (kernel == HeatKernels::avx2) {
+		return "avx2";
+	}
+	return "scalar";
+}
+
+HeatKernels::UniformFunction HeatKernels::
+uniform (Function kernel)
+{
+	if (kernel == HeatKernels::avx512) {
+		return HeatKernels::uniformAvx512;
+	}
+	if (kernel == HeatKernels::avx2) {
+		return HeatKernels::uniformAvx2;
+	}
+	return HeatKernels::uniformScalar;
+}
@@ -0,0 +1,184 @@
+#ifndef __HEAT_KERNELS_H
+#define __HEAT_KERNELS_H
+
+#include <cstddef>
+#include <string>
+
+namespace Enki
+{
+#ifdef WORLDHEAT_FLOAT
+	/**
+	 * Type of the temperature cells of {@code WorldHeat}.  Macro {@code
+	 * WORLDHEAT_FLOAT} selects single precision, which halves the memory
+	 * traffic and doubles the number of vector lanes.  Temperatures stay
+	 * between 20 and 40 degrees, so single precision keeps about five
+	 * significant digits of the temperature differences.
+	 */
+	typedef float HeatValue;
+#else
+	typedef double HeatValue;
+#endif
+
+#ifdef WORLDHEAT_DIFFUSIVITY_CLASSES
+	/**
+	 * Type of the heat diffusivity cells of {@code WorldHeat}.  Macro
+	 * {@code WORLDHEAT_DIFFUSIVITY_CLASSES} stores in each cell the index of
+	 * its diffusivity in a small table instead of the diffusivity itself.
+	 * There are only a few distinct diffusivities, air and copper, so one
+	 * byte per cell is enough.  The diffusivity plane is only read when the
+	 * face conductances are rebuilt.
+	 */
+	typedef unsigned char HeatDiffusivity;
+#else
+	typedef HeatValue HeatDiffusivity;
+#endif
+
+	/**
+	 * Functions that update a rectangular block of the heat grid.  Every
+	 * function computes the same discrete equation as the scalar one, and
+	 * the vector versions perform the floating point operations in the
+	 * same order, so that all of them produce the same bits.
+
+	 * <p> The vector versions are compiled for a specific instruction set
+	 * with function attributes.  Method {@code select(const
+	 * std::string&)} checks at run time which instruction sets are
+	 * supported by the processor.
+
+	 * <p> Pointers point to cell {@code (0,0)} of planes that share the same
+	 * {@code GridLayout}.  The block is given by {@code [xmin,xmax)} and
+	 * {@code [ymin,ymax)}.
+
+	 * <p> Heat flows through the faces between adjacent cells.  Cell
+	 * {@code (x,y)} of the east plane holds the conductance of the face
+	 * between cells {@code (x,y)} and {@code (x+1,y)}, and cell {@code
+	 * (x,y)} of the north plane the conductance of the face between cells
+	 * {@code (x,y)} and {@code (x,y+1)}.  Conductances already include the
+	 * factor of the discrete equation, so a kernel reads three planes and
+	 * performs no multiplication besides the five fluxes.
+	 */
+	class HeatKernels
+	{
+	public:
+		/**
+		 * Maximum number of distinct diffusivities.
+		 */
+		static const int MAXIMUM_CLASSES = 8;
+		/**
+		 * Signature of a heat kernel.
+		 *
+		 * @param heat current temperature plane.
+		 *
+		 * @param east conductance plane of the faces along x.
+		 *
+		 * @param north conductance plane of the faces along y.
+		 *
+		 * @param nextHeat temperature plane that is written.
+		 *
+		 * @param stride distance between consecutive columns.
+		 *
+		 * @param normalHeat environmental temperature.
+		 *
+		 * @param loss conductance between each cell and the outside world,
+		 * the cell dissipation multiplied by the factor of the discrete
+		 * equation.
+		 */
+		typedef void (*Function) (
+			const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+			std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+			double normalHeat, double loss);
+
+		static void scalar (
+			const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+			std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+			double normalHeat, double loss);
+
+		static void avx2 (
+			const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+			std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+			double normalHeat, double loss);
+
+		static void avx512 (
+			const HeatValue *heat, const HeatValue *east, const HeatValue *north, HeatValue *nextHeat,
+			std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+			double normalHeat, double loss);
+		/**
+		 * Signature of a heat kernel for blocks where every face has the
+		 * same conductance.  It reads no conductance plane and produces the
+		 * same bits as a general kernel given planes filled with {@code
+		 * conductance}.
+		 */
+		typedef void (*UniformFunction) (
+			const HeatValue *heat, double conductance, HeatValue *nextHeat,
+			std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+			double normalHeat, double loss);
+
+		static void uniformScalar (
+			const HeatValue *heat, double conductance, HeatValue *nextHeat,
+			std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+			double normalHeat, double loss);
+
+		static void uniformAvx2 (
+			const HeatValue *heat, double conductance, HeatValue *nextHeat,
+			std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+			double normalHeat, double loss);
+
+		static void uniformAvx512 (
+			const HeatValue *heat, double conductance, HeatValue *nextHeat,
+			std::ptrdiff_t stride, int xmin, int ymin, int xmax, int ymax,
+			double normalHeat, double loss);
+		/**
+		 * Return the kernel with the given name, {@code "scalar"}, {@code
+		 * "avx2"} or {@code "avx512"}.  Name {@code "auto"} returns the
+		 * widest kernel supported by the processor.  If the processor does
+		 * not support the requested kernel, the scalar kernel is returned.
+		 */
+		static Function select (const std::string &name);
+		/**
+		 * Return the name of the given kernel.
+		 */
+		static const char *name (Function kernel);
+		/**
+		 * Return the uniform kernel for the instruction set of the given
+		 * kernel.
+		 */
+		static UniformFunction uniform (Function kernel);
+		/**
+		 * Return the diffusivity of cell {@code index} of a diffusivity
+		 * plane.  Parameter {@code classes} is the diffusivity table, it is
+		 * only read with diffusivity classes.
+		 */
+		static HeatValue diffusivityAt (const HeatDiffusivity *diffusivity, std::ptrdiff_t index, const HeatValue *classes)
+		{
+#ifdef WORLDHEAT_DIFFUSIVITY_CLASSES
+			return classes [diffusivity [index]];
+#else
+			return diffusivity [index];
+#endif
+		}
+		/**
+		 * Return the conductance of a face between cells with the given
+		 * diffusivities, their harmonic mean.  A face between cells with the
+		 * same diffusivity has that diffusivity.
+		 */
+		static double faceConductance (double a, double b)
+		{
+			if (a == b) {
+				return a;
+			}
+			if (a + b == 0) {
+				return 0;
+			}
+			return 2 * a * b / (a + b);
+		}
+	private:
+		static bool supported (const std::string &name);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,196 @@
+#include <cstring>
+#include <iostream>
+
+#include "HeatLog.h"
+
+using namespace Enki;
+
+std::string HeatLog::FORMAT = "text";
+/*const*/ int HeatLog::RING_FRAMES = 16;
+
+static const char HEAT_LOG_MAGIC [8] = {'A', 'S', 'I', 'S', 'H', 'L', 'O', 'G'};
+static const boost::uint32_t HEAT_LOG_VERSION = 1;
+
+HeatLog::
+HeatLog (const std::string &fileName, const std::vector<std::ptrdiff_t> &cells, int columns):
+	format (HeatLog::selectFormat (HeatLog::FORMAT)),
+	cells (cells),
+	columns (columns),
+	rows (cells.size () / std::max (1, columns)),
+	stream (fileName.c_str (), std::ofstream::out | std::ofstream::trunc | std::ofstream::binary),
+	frames (std::max (1, HeatLog::RING_FRAMES), std::vector<double> (cells.size ())),
+	times (frames.size ()),
+	head (0),
+	count (0),
+	previous (cells.size (), 0),
+	writtenFrames (0),
+	droppedFrames (0),
+	stopping (false)
+{
+	if (this->format != TEXT) {
+		const boost::uint32_t header [4] = {
+			HEAT_LOG_VERSION,
+			this->format == DELTA ? 1u : 0u,
+			(boost::uint32_t) this->columns,
+			(boost::uint32_t) this->rows
+		};
+		this->stream.write (HEAT_LOG_MAGIC, sizeof (HEAT_LOG_MAGIC));
+		this->stream.write (reinterpret_cast<const char *> (header), sizeof (header));
+	}
+	this->thread = new boost::thread (&HeatLog::run, this);
+}
+
+HeatLog::
+~HeatLog ()
+{
+	{
+		boost::lock_guard<boost::mutex> lock (this->mutex);
+		this->stopping = true;
+	}
+	this->frameReady.notify_one ();
+	this->thread->join ();
+	delete this->thread;
+	this->stream.flush ();
+	std::cout
+		<< "Closing heat log, " << this->writtenFrames << " frames written, "
+		<< this->droppedFrames << " frames dropped\n";
+}
+
+bool HeatLog::
+record (double time, const GridField<HeatValue> &plane)
+{
+	int slot;
+	{
+		boost::lock_guard<boost::mutex> lock (this->mutex);
+		if (this->count == (int) this->frames.size ()) {
+			this->droppedFrames++;
+			return false;
+		}
+		slot = (this->head + this->count) % this->frames.size ();
+	}
+	// the log thread does not read the slot until it is counted
+	std::vector<double> &frame = this->frames [slot];
+	const HeatValue *data = plane.data ();
+	for (std::size_t i = 0; i < this->cells.size (); i++) {
+		frame [i] = data [this->cells [i]];
+	}
+	{
+		boost::lock_guard<boost::mutex> lock (this->mutex);
+		this->times [slot] = time;
+		this->count++;
+	}
+	this->frameReady.notify_one ();
+	return true;
+}
+
+boost::uint64_t HeatLog::
+getDroppedFrames ()
+{
+	boost::lock_guard<boost::mutex> lock (this->mutex);
+	return this->droppedFrames;
+}
+
+void HeatLog::
+run ()
+{
+	boost::unique_lock<boost::mutex> lock (this->mutex);
+	while (true) {
+		while (this->count == 0 && !this->stopping) {
+			this->frameReady.wait (lock);
+		}
+		if (this->count == 0) {
+			return ;
+		}
+		const int slot = this->head;
+		const double time = this->times [slot];
+		lock.unlock ();
+		this->write (time, this->frames [slot]);
+		lock.lock ();
+		this->head = (this->head + 1) % this->frames.size ();
+		this->count--;
+		this->writtenFrames++;
+	}
+}
+
+void HeatLog::
+write (double time, const std::vector<double> &frame)
+{
+	switch (this->format) {
+	case TEXT:
+		this->stream << time;
+		for (std::vector<double>::const_iterator cell = frame.begin (); cell != frame.end (); cell++) {
+			this->stream << '\t' << *cell;
+		}
+		this->stream << '\n';
+		return ;
+	case BINARY: {
+		const boost::uint32_t bytes = frame.size () * sizeof (double);
+		this->stream.write (reinterpret_cast<const char *> (&time), sizeof (time));
+		this->stream.write (reinterpret_cast<const char *> (&bytes), sizeof (bytes));
+		if (bytes > 0) {
+			this->stream.write (reinterpret_cast<const char *> (&frame [0]), bytes);
+		}
+		return ;
+	}
+	case DELTA: {
+		this->encodeDelta (frame);
+		const boost::uint32_t bytes = this->payload.size () * sizeof (boost::uint32_t);
+		this->stream.write (reinterpret_cast<const char *> (&time), sizeof (time));
+		this->stream.write (reinterpret_cast<const char *> (&bytes), sizeof (bytes));
+		if (bytes > 0) {
+			this->stream.write (reinterpret_cast<const char *> (&this->payload [0]), bytes);
+		}
+		return ;
+	}
+	}
+}
+
+void HeatLog::
+encodeDelta (const std::vector<double> &frame)
+{
+	this->payload.clear ();
+	const std::size_t n = frame.size ();
+	std::size_t i = 0;
+	while (i < n) {
+		boost::uint64_t bits;
+		// count the cells that did not change
+		const std::size_t zeroStart = i;
+		for (; i < n; i++) {
+			memcpy (&bits, &frame [i], sizeof (bits));
+			if (bits != this->previous [i]) {
+				break;
+			}
+		}
+		const std::size_t literalStart = i;
+		for (; i < n; i++) {
+			memcpy (&bits, &frame [i], sizeof (bits));
+			if (bits == this->previous [i]) {
+				break;
+			}
+		}
+		this->payload.push_back (literalStart - zeroStart);
+		this->payload.push_back (i - literalStart);
+		for (std::size_t j = literalStart; j < i; j++) {
+			memcpy (&bits, &frame [j], sizeof (bits));
+			const boost::uint64_t delta = bits ^ this->previous [j];
+			this->previous [j] = bits;
+			this->payload.push_back ((boost::uint32_t) delta);
+			this->payload.push_back ((boost::uint32_t) (delta >> 32));
+		}
+	}
+}
+
+HeatLog::Format HeatLog::
+selectFormat (const std::string &name)
+{
+	if (name == "binary") {
+		return BINARY;
+	}
+	if (name == "delta") {
+		return DELTA;
+	}
+	if (name != "text") {
+		std::cerr << "Unknown heat log format " << name << ", using text format\n";
+	}
+	return TEXT;
+}
@@ -0,0 +1,139 @@
+#ifndef __HEAT_LOG_H
+#define __HEAT_LOG_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+#ifndef Q_MOC_RUN
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#endif
+
+#include "interactions/GridField.h"
+#include "interactions/HeatKernels.h"
+
+namespace Enki
+{
+	/**
+	 * Log of a set of cells of a heat grid, written by a thread of its
+	 * own.  The simulation thread copies the grid to a free frame of a
+	 * bounded ring and returns.  The log thread formats and writes the
+	 * frames in order.  If the ring is full, because the disk is slower
+	 * than the simulation, the frame is dropped and counted instead of
+	 * stalling the simulation.
+
+	 * <p> Frames hold the logged cells in the order given to the
+	 * constructor, as a number of rows of the same number of columns.  The
+	 * full grid log has the interior cells row by row, {@code x}
+	 * contiguous, as the text log always did.  Field {@code FORMAT} selects
+	 * how frames are written:
+
+	 * <ul>
+
+	 * <li> {@code "text"} writes a line per frame with the time and the
+	 * cells separated by tabs;
+
+	 * <li> {@code "binary"} writes a header followed, for each frame, by
+	 * the time, the payload size in bytes and the cells as doubles;
+
+	 * <li> {@code "delta"} writes the same header and frames but the
+	 * payload holds the bits of each cell xor those of the previous written
+	 * frame, as runs of zero words and runs of literal words.  Cells that
+	 * did not change cost nothing but their share of a run count.
+
+	 * </ul>
+
+	 * <p> The binary header is the magic {@code ASISHLOG}, the version, the
+	 * format (0 binary, 1 delta) and the number of columns and rows, as 32
+	 * bit integers.  A delta payload is a sequence of pairs of 32 bit
+	 * integers, the number of zero words and the number of literal words,
+	 * each pair followed by its literal words.
+	 */
+	class HeatLog
+	{
+	public:
+		/**
+		 * Format of new logs, {@code "text"}, {@code "binary"} or {@code
+		 * "delta"}.
+		 */
+		static std::string FORMAT;
+		/**
+		 * Number of frames of the ring between the simulation and the log
+		 * thread.
+		 */
+		static /*const*/ int RING_FRAMES;
+	private:
+		enum Format {TEXT, BINARY, DELTA};
+		const Format format;
+		/**
+		 * Offsets of the logged cells from cell {@code (0,0)} of the grid
+		 * planes.
+		 */
+		const std::vector<std::ptrdiff_t> cells;
+		/**
+		 * Number of columns and rows of a frame.
+		 */
+		const int columns, rows;
+		std::ofstream stream;
+		/**
+		 * Ring of frames.  Frames {@code head} to {@code head+count-1},
+		 * modulo the ring size, wait to be written.
+		 */
+		std::vector<std::vector<double> > frames;
+		std::vector<double> times;
+		int head;
+		int count;
+		/**
+		 * Previous written frame, used by the delta format.
+		 */
+		std::vector<boost::uint64_t> previous;
+		/**
+		 * Encoded payload of the frame being written.
+		 */
+		std::vector<boost::uint32_t> payload;
+		boost::uint64_t writtenFrames;
+		boost::uint64_t droppedFrames;
+		bool stopping;
+		boost::mutex mutex;
+		boost::condition_variable frameReady;
+		boost::thread *thread;
+
+		HeatLog (const HeatLog &);
+		HeatLog &operator= (const HeatLog &);
+	public:
+		/**
+		 * Create a log of the given cells, given by their offset in the
+		 * grid planes, and start its thread.  The number of cells must be a
+		 * multiple of {@code columns}.
+		 */
+		HeatLog (const std::string &fileName, const std::vector<std::ptrdiff_t> &cells, int columns);
+		/**
+		 * Write the pending frames, stop the log thread and print how many
+		 * frames were written and dropped.
+		 */
+		~HeatLog ();
+		/**
+		 * Copy the logged cells of the given plane to the ring.  Return
+		 * false if the ring was full and the frame was dropped.
+		 */
+		bool record (double time, const GridField<HeatValue> &plane);
+		/**
+		 * Return the number of frames dropped so far.
+		 */
+		boost::uint64_t getDroppedFrames ();
+	private:
+		void run ();
+		void write (double time, const std::vector<double> &frame);
+		void encodeDelta (const std::vector<double> &frame);
+		static Format selectFormat (const std::string &name);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cmath>
+
+#include "HeatMultigrid.h"
+
+using namespace Enki;
+
+HeatMultigrid::
+HeatMultigrid (
+	int sizeX, int sizeY, const std::vector<char> &unknown,
+	const std::vector<double> &east, const std::vector<double> &north, const std::vector<double> &diagonal):
+	levels (1)
+{
+	Level &fine = this->levels [0];
+	fine.sizeX = sizeX;
+	fine.sizeY = sizeY;
+	fine.unknown = unknown;
+	fine.east = east;
+	fine.north = north;
+	fine.diagonal = diagonal;
+	fine.x.resize (sizeX * sizeY);
+	fine.b.resize (sizeX * sizeY);
+	while (this->levels.back ().sizeX > COARSEST_SIZE && this->levels.back ().sizeY > COARSEST_SIZE) {
+		coarsen ();
+	}
+}
+
+int HeatMultigrid::
+solve (const std::vector<double> &rhs, std::vector<double> &x, double tolerance, int maximumIterations)
+{
+	const Level &fine = this->levels [0];
+	const std::size_t n = rhs.size ();
+	std::vector<double> r (n), z (n), p (n), q (n);
+	std::vector<double> solution (n);
+	for (std::size_t i = 0; i < n; i++) {
+		solution [i] = fine.unknown [i] ? x [i] : 0;
+	}
+	multiply (fine, solution, q);
+	double rhsNorm = 0;
+	for (std::size_t i = 0; i < n; i++) {
+		r [i] = fine.unknown [i] ? rhs [i] - q [i] : 0;
+		rhsNorm += rhs [i] * rhs [i];
+	}
+	const double limit = tolerance * tolerance * std::max (rhsNorm, 1e-300);
+	precondition (r, z);
+	p = z;
+	double rz = 0;
+	double rr = 0;
+	for (std::size_t i = 0; i < n; i++) {
+		rz += r [i] * z [i];
+		rr += r [i] * r [i];
+	}
+	int iteration = 0;
+	while (rr > limit) {
+		if (iteration == maximumIterations) {
+			iteration = -1;
+			break;
+		}
+		iteration++;
+		multiply (fine, p, q);
+		double pq = 0;
+		for (std::size_t i = 0; i < n; i++) {
+			pq += p [i] * q [i];
+		}
+		if (pq <= 0) {
+			break;
+		}
+		const double alpha = rz / pq;
+		rr = 0;
+		for (std::size_t i = 0; i < n; i++) {
+			solution [i] += alpha * p [i];
+			r [i] -= alpha * q [i];
+			rr += r [i] * r [i];
+		}
+		precondition (r, z);
+		double nextRz = 0;
+		for (std::size_t i = 0; i < n; i++) {
+			nextRz += r [i] * z [i];
+		}
+		const double beta = nextRz / rz;
+		rz = nextRz;
+		for (std::size_t i = 0; i < n; i++) {
+			p [i] = z [i] + beta * p [i];
+		}
+	}
+	for (std::size_t i = 0; i < n; i++) {
+		if (fine.unknown [i]) {
+			x [i] = solution [i];
+		}
+	}
+	return iteration;
+}
+
+void HeatMultigrid::
+multiply (const Level &level, const std::vector<double> &x, std::vector<double> &y) const
+{
+	const int sizeX = level.sizeX;
+	const int sizeY = level.sizeY;
+	for (int cx = 0; cx < sizeX; cx++) {
+		for (int cy = 0; cy < sizeY; cy++) {
+			const int i = cx * sizeY + cy;
+			if (!level.unknown [i]) {
+				y [i] = 0;
+				continue;
+			}
+			double sum = level.diagonal [i] * x [i];
+			if (cx > 0) {
+				sum -= level.east [i - sizeY] * x [i - sizeY];
+			}
+			if (cx + 1 < sizeX) {
+				sum -= level.east [i] * x [i + sizeY];
+			}
+			if (cy > 0) {
+				sum -= level.north [i - 1] * x [i - 1];
+			}
+			if (cy + 1 < sizeY) {
+				sum -= level.north [i] * x [i + 1];
+			}
+			y [i] = sum;
+		}
+	}
+}
+
+void HeatMultigrid::
+smooth (Level &level, bool forward) const
+{
+	const int sizeX = level.sizeX;
+	const int sizeY = level.sizeY;
+	const int count = sizeX * sizeY;
+	for (int k = 0; k < count; k++) {
+		const int i = forward ? k : count - 1 - k;
+		if (!level.unknown [i] || level.diagonal [i] == 0) {
+			continue;
+		}
+		const int cx = i / sizeY;
+		const int cy = i % sizeY;
+		double sum = level.b [i];
+		if (cx > 0) {
+			sum += level.east [i - sizeY] * level.x [i - sizeY];
+		}
+		if (cx + 1 < sizeX) {
+			sum += level.east [i] * level.x [i + sizeY];
+		}
+		if (cy > 0) {
+			sum += level.north [i - 1] * level.x [i - 1];
+		}
+		if (cy + 1 < sizeY) {
+			sum += level.north [i] * level.x [i + 1];
+		}
+		level.x [i] = sum / level.diagonal [i];
+	}
+}
+
+void HeatMultigrid::
+cycle (int l)
+{
+	Level &level = this->levels [l];
+	std::fill (level.x.begin (), level.x.end (), 0.0);
+	if (l + 1 == (int) this->levels.size ()) {
+		for (int s = 0; s < COARSEST_SWEEPS; s++) {
+			smooth (level, true);
+			smooth (level, false);
+		}
+		return ;
+	}
+	for (int s = 0; s < SMOOTHING_SWEEPS; s++) {
+		smooth (level, true);
+	}
+	// restrict the residual, the sum over each block
+	Level &coarse = this->levels [l + 1];
+	std::vector<double> residual (level.x.size ());
+	multiply (level, level.x, residual);
+	std::fill (coarse.b.begin (), coarse.b.end (), 0.0);
+	for (int cx = 0; cx < level.sizeX; cx++) {
+		for (int cy = 0; cy < level.sizeY; cy++) {
+			const int i = cx * level.sizeY + cy;
+			if (level.unknown [i]) {
+				coarse.b [(cx / 2) * coarse.sizeY + cy / 2] += level.b [i] - residual [i];
+			}
+		}
+	}
+	cycle (l + 1);
+	// interpolate the correction, constant over each block
+	for (int cx = 0; cx < level.sizeX; cx++) {
+		for (int cy = 0; cy < level.sizeY; cy++) {
+			const int i = cx * level.sizeY + cy;
+			if (level.unknown [i]) {
+				level.x [i] += coarse.x [(cx / 2) * coarse.sizeY + cy / 2];
+			}
+		}
+	}
+	for (int s = 0; s < SMOOTHING_SWEEPS; s++) {
+		smooth (level, false);
+	}
+}
+
+void HeatMultigrid::
+precondition (const std::vector<double> &r, std::vector<double> &z)
+{
+	Level &fine = this->levels [0];
+	fine.b = r;
+	cycle (0);
+	z = fine.x;
+}
+
+void HeatMultigrid::
+coarsen ()
+{
+	const Level &fine = this->levels.back ();
+	Level coarse;
+	coarse.sizeX = (fine.sizeX + 1) / 2;
+	coarse.sizeY = (fine.sizeY + 1) / 2;
+	const int count = coarse.sizeX * coarse.sizeY;
+	coarse.unknown.assign (count, 0);
+	coarse.east.assign (count, 0.0);
+	coarse.north.assign (count, 0.0);
+	coarse.diagonal.assign (count, 0.0);
+	coarse.x.assign (count, 0.0);
+	coarse.b.assign (count, 0.0);
+	for (int cx = 0; cx < fine.sizeX; cx++) {
+		for (int cy = 0; cy < fine.sizeY; cy++) {
+			const int i = cx * fine.sizeY + cy;
+			if (!fine.unknown [i]) {
+				continue;
+			}
+			const int c = (cx / 2) * coarse.sizeY + cy / 2;
+			coarse.unknown [c] = 1;
+			coarse.diagonal [c] += fine.diagonal [i];
+			// faces inside a block cancel part of the diagonal, the others
+			// connect two blocks
+			if (cx + 1 < fine.sizeX) {
+				if (cx % 2 == 0) {
+					coarse.diagonal [c] -= 2 * fine.east [i];
+				}
+				else {
+					coarse.east [c] += fine.east [i];
+				}
+			}
+			if (cy + 1 < fine.sizeY) {
+				if (cy % 2 == 0) {
+					coarse.diagonal [c] -= 2 * fine.north [i];
+				}
+				else {
+					coarse.north [c] += fine.north [i];
+				}
+			}
+		}
+	}
+	this->levels.push_back (coarse);
+}
@@ -0,0 +1,113 @@
+#ifndef __HEAT_MULTIGRID_H
+#define __HEAT_MULTIGRID_H
+
+#include <vector>
+
+namespace Enki
+{
+	/**
+	 * Solver of the steady state of the heat equation of {@code WorldHeat}.
+	 * The system has an equation per unknown cell:
+
+	 * <pre>
+	 * diagonal[i] * x[i] - sum (conductance[i,j] * x[j]) = rhs[i]
+	 * </pre>
+
+	 * <p> where {@code j} are the unknown neighbours of cell {@code i}.
+	 * The diagonal holds the conductances of every face of the cell, to
+	 * unknown and to known cells, plus its dissipation.  Known cells only
+	 * appear in the right hand side.  The matrix is symmetric and
+	 * diagonally dominant, so the system is solved with the conjugate
+	 * gradient method.
+
+	 * <p> The preconditioner is a geometric multigrid V-cycle.  A cell of a
+	 * coarse level is a block of two by two cells of the finer level, and
+	 * the coarse system is the Galerkin product of the fine system with
+	 * piecewise constant interpolation: the conductance between two coarse
+	 * cells is the sum of the fine conductances between their blocks.  The
+	 * smoother is a forward Gauss-Seidel sweep before the coarse correction
+	 * and a backward one after, so that the preconditioner is symmetric.
+
+	 * <p> Cells are indexed by {@code x*sizeY+y}.  Plane {@code east} holds
+	 * the conductance between cells {@code (x,y)} and {@code (x+1,y)}, and
+	 * plane {@code north} between cells {@code (x,y)} and {@code (x,y+1)}.
+	 * Both must be zero for faces with a known cell.
+	 */
+	class HeatMultigrid
+	{
+		struct Level
+		{
+			int sizeX, sizeY;
+			std::vector<char> unknown;
+			std::vector<double> east, north, diagonal;
+			/**
+			 * Correction and right hand side of the V-cycle.
+			 */
+			std::vector<double> x, b;
+		};
+		std::vector<Level> levels;
+	public:
+		/**
+		 * Number of Gauss-Seidel sweeps before and after each coarse
+		 * correction.
+		 */
+		static const int SMOOTHING_SWEEPS = 2;
+		/**
+		 * Number of symmetric Gauss-Seidel sweeps that solve the coarsest
+		 * level.
+		 */
+		static const int COARSEST_SWEEPS = 20;
+		/**
+		 * Levels are coarsened until one of their sizes is at most this
+		 * number.
+		 */
+		static const int COARSEST_SIZE = 4;
+		/**
+		 * Build the levels of the given system.
+		 */
+		HeatMultigrid (
+			int sizeX, int sizeY, const std::vector<char> &unknown,
+			const std::vector<double> &east, const std::vector<double> &north, const std::vector<double> &diagonal);
+		/**
+		 * Solve the system with the given right hand side, starting from
+		 * {@code x}, until the norm of the residual is {@code tolerance}
+		 * times the norm of the right hand side.  Known cells of {@code x}
+		 * are not read and are left unchanged.  Return the number of
+		 * iterations, or -1 if the solution did not converge within {@code
+		 * maximumIterations}.
+		 */
+		int solve (const std::vector<double> &rhs, std::vector<double> &x, double tolerance, int maximumIterations);
+	private:
+		/**
+		 * Compute {@code y=Ax} at the given level.
+		 */
+		void multiply (const Level &level, const std::vector<double> &x, std::vector<double> &y) const;
+		/**
+		 * Perform a Gauss-Seidel sweep of {@code level.x} at the given
+		 * level, with increasing or decreasing cell indexes.
+		 */
+		void smooth (Level &level, bool forward) const;
+		/**
+		 * Solve {@code level.x} approximately from {@code level.b} with a
+		 * V-cycle starting at level {@code l}.
+		 */
+		void cycle (int l);
+		/**
+		 * Apply the preconditioner to residual {@code r} and write the
+		 * result in {@code z}.
+		 */
+		void precondition (const std::vector<double> &r, std::vector<double> &z);
+		/**
+		 * Build the level that follows the last one.
+		 */
+		void coarsen ();
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
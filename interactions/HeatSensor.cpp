@@ -11,10 +11,12 @@ HeatSensor (Robot* owner, Vector relativePosition,
 				double ambientTemperature
 				):
 	Component (owner, relativePosition, Component::OMNIDIRECTIONAL), 
+	measuredHeat (ambientTemperature),
+	sampleRound (-1),
+	sampleIndex (-1),
 	minMeasurableHeat (minMeasurableHeat),
 	maxMeasurableHeat (maxMeasurableHeat),
-	thermalResponseTime (thermalResponseTime),
-	measuredHeat (ambientTemperature)
+	thermalResponseTime (thermalResponseTime)
 {
 }
 
@@ -23,6 +25,8 @@ HeatSensor (Robot* owner, Vector relativePosition,
 				double minMeasurableHeat, double maxMeasurableHeat
 				):
 	Component (owner, relativePosition, Component::OMNIDIRECTIONAL), 
+	sampleRound (-1),
+	sampleIndex (-1),
 	minMeasurableHeat (minMeasurableHeat),
 	maxMeasurableHeat (maxMeasurableHeat),
 	thermalResponseTime (-1)
@@ -40,7 +44,13 @@ step (double dt, PhysicSimulation* ps)
 {
 	WorldHeat *worldHeat = dynamic_cast<WorldHeat *> (ps);
 	if (worldHeat != NULL) {
-		this->measuredHeat = worldHeat->getHeatAt (this->absolutePosition);
+		// use the sample gathered after the last update if the sensor did
+		// not move, and request the next one
+		if (!worldHeat->getHeatSample (this->sampleRound, this->sampleIndex, this->absolutePosition, this->measuredHeat)) {
+			this->measuredHeat = worldHeat->sampleHeatAt (this->absolutePosition);
+		}
+		this->sampleRound = worldHeat->getSampleRound ();
+		this->sampleIndex = worldHeat->requestHeatSample (this->absolutePosition);
 		// double factor = std::min (1.0, this->thermalResponseTime * dt);
 		// this->measuredHeat =
 		// 	factor * worldHeat->getHeatAt (this->absolutePosition)
@@ -20,6 +20,11 @@ namespace Enki
 		public Component
 	{
 		double measuredHeat;
+		/**
+		 * Round and index of the temperature sample requested from the heat
+		 * model in the previous step.
+		 */
+		int sampleRound, sampleIndex;
 	public:
 		const double minMeasurableHeat;
 		const double maxMeasurableHeat;
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cmath>
+
+#include "HeatSpectral.h"
+
+using namespace Enki;
+
+HeatSpectral::Fourier::
+Fourier (int length):
+	length (length)
+{
+	const bool power = (length & (length - 1)) == 0;
+	this->size = 1;
+	while (this->size < (power ? length : 2 * length - 1)) {
+		this->size *= 2;
+	}
+	this->twiddles.resize (this->size / 2);
+	for (int k = 0; k < this->size / 2; k++) {
+		this->twiddles [k] = std::polar (1.0, -2 * M_PI * k / this->size);
+	}
+	if (power) {
+		return ;
+	}
+	// Bluestein's algorithm, a transform is a convolution with a chirp
+	this->chirp.resize (length);
+	for (int k = 0; k < length; k++) {
+		// k*k modulo 2*length keeps the angle accurate
+		const long square = ((long) k * k) % (2 * length);
+		this->chirp [k] = std::polar (1.0, -M_PI * square / length);
+	}
+	this->kernel.assign (this->size, std::complex<double> (0));
+	this->kernel [0] = std::conj (this->chirp [0]);
+	for (int k = 1; k < length; k++) {
+		this->kernel [k] = std::conj (this->chirp [k]);
+		this->kernel [this->size - k] = std::conj (this->chirp [k]);
+	}
+	radix2 (this->kernel, false);
+	this->work.resize (this->size);
+}
+
+void HeatSpectral::Fourier::
+transform (std::vector<std::complex<double> > &data)
+{
+	if (this->chirp.empty ()) {
+		radix2 (data, false);
+		return ;
+	}
+	for (int k = 0; k < this->length; k++) {
+		this->work [k] = data [k] * this->chirp [k];
+	}
+	std::fill (this->work.begin () + this->length, this->work.end (), std::complex<double> (0));
+	radix2 (this->work, false);
+	for (int k = 0; k < this->size; k++) {
+		this->work [k] *= this->kernel [k];
+	}
+	radix2 (this->work, true);
+	for (int k = 0; k < this->length; k++) {
+		data [k] = this->chirp [k] * this->work [k] / (double) this->size;
+	}
+}
+
+void HeatSpectral::Fourier::
+radix2 (std::vector<std::complex<double> > &data, bool inverse) const
+{
+	const int n = this->size;
+	for (int i = 1, j = 0; i < n; i++) {
+		int bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			std::swap (data [i], data [j]);
+		}
+	}
+	for (int half = 1; half < n; half *= 2) {
+		const int step = n / (2 * half);
+		for (int start = 0; start < n; start += 2 * half) {
+			for (int k = 0; k < half; k++) {
+				const std::complex<double> w = inverse ? std::conj (this->twiddles [k * step]) : this->twiddles [k * step];
+				const std::complex<double> odd = w * data [start + k + half];
+				data [start + k + half] = data [start + k] - odd;
+				data [start + k] += odd;
+			}
+		}
+	}
+}
+
+HeatSpectral::
+HeatSpectral (int columns, int rows):
+	columns (columns),
+	rows (rows),
+	columnFourier (2 * (rows + 1)),
+	rowFourier (2 * (columns + 1)),
+	conductance (-1),
+	loss (-1),
+	deltaTime (-1),
+	decay (columns * rows),
+	gain (columns * rows),
+	heat (columns * rows),
+	source (columns * rows),
+	line (2 * (std::max (columns, rows) + 1)),
+	values (std::max (columns, rows))
+{
+}
+
+void HeatSpectral::
+advance (
+	const HeatValue *heat, HeatValue *next, std::ptrdiff_t stride,
+	double conductance, double loss, double normalHeat, double deltaTime)
+{
+	const int columns = this->columns;
+	const int rows = this->rows;
+	if (conductance != this->conductance || loss != this->loss || deltaTime != this->deltaTime) {
+		for (int p = 1; p <= columns; p++) {
+			const double sx = 2 * sin (M_PI * p / (2 * (columns + 1)));
+			for (int q = 1; q <= rows; q++) {
+				const double sy = 2 * sin (M_PI * q / (2 * (rows + 1)));
+				const double eigenvalue = conductance * (sx * sx + sy * sy) + loss;
+				const int i = (p - 1) * rows + q - 1;
+				this->decay [i] = exp (-eigenvalue * deltaTime);
+				this->gain [i] = eigenvalue > 0 ? (1 - this->decay [i]) / eigenvalue : deltaTime;
+			}
+		}
+		this->conductance = conductance;
+		this->loss = loss;
+		this->deltaTime = deltaTime;
+	}
+	// border cells and dissipation are constant sources of the interior
+	for (int x = 1; x <= columns; x++) {
+		const HeatValue *h = heat + x * stride;
+		for (int y = 1; y <= rows; y++) {
+			const int i = (x - 1) * rows + y - 1;
+			this->heat [i] = h [y];
+			double s = loss * normalHeat;
+			if (x == 1) {
+				s += conductance * h [y - stride];
+			}
+			if (x == columns) {
+				s += conductance * h [y + stride];
+			}
+			if (y == 1) {
+				s += conductance * h [y - 1];
+			}
+			if (y == rows) {
+				s += conductance * h [y + 1];
+			}
+			this->source [i] = s;
+		}
+	}
+	transform (this->heat);
+	transform (this->source);
+	for (int i = 0; i < columns * rows; i++) {
+		this->heat [i] = this->decay [i] * this->heat [i] + this->gain [i] * this->source [i];
+	}
+	transform (this->heat);
+	for (int x = 1; x <= columns; x++) {
+		HeatValue *n = next + x * stride;
+		for (int y = 1; y <= rows; y++) {
+			n [y] = this->heat [(x - 1) * rows + y - 1];
+		}
+	}
+}
+
+void HeatSpectral::
+transform (std::vector<double> &plane)
+{
+	const int columns = this->columns;
+	const int rows = this->rows;
+	for (int x = 0; x < columns; x++) {
+		std::copy (plane.begin () + x * rows, plane.begin () + (x + 1) * rows, this->values.begin ());
+		sineTransform (this->columnFourier, rows);
+		std::copy (this->values.begin (), this->values.begin () + rows, plane.begin () + x * rows);
+	}
+	for (int y = 0; y < rows; y++) {
+		for (int x = 0; x < columns; x++) {
+			this->values [x] = plane [x * rows + y];
+		}
+		sineTransform (this->rowFourier, columns);
+		for (int x = 0; x < columns; x++) {
+			plane [x * rows + y] = this->values [x];
+		}
+	}
+}
+
+void HeatSpectral::
+sineTransform (Fourier &fourier, int n)
+{
+	// odd extension of length 2(n+1), whose transform is -2i times the
+	// sine transform
+	const int length = 2 * (n + 1);
+	this->line [0] = 0;
+	this->line [n + 1] = 0;
+	for (int j = 1; j <= n; j++) {
+		this->line [j] = this->values [j - 1];
+		this->line [length - j] = -this->values [j - 1];
+	}
+	fourier.transform (this->line);
+	const double scale = sqrt (2.0 / (n + 1));
+	for (int k = 1; k <= n; k++) {
+		this->values [k - 1] = -0.5 * scale * this->line [k].imag ();
+	}
+}
@@ -0,0 +1,108 @@
+#ifndef __HEAT_SPECTRAL_H
+#define __HEAT_SPECTRAL_H
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "HeatKernels.h"
+
+namespace Enki
+{
+	/**
+	 * Spectral solver of the heat equation of {@code WorldHeat} for a
+	 * rectangular grid of uniform diffusivity.  The discrete operator of
+	 * such a grid, with the border cells as fixed temperature boundary
+	 * conditions, is diagonal in the basis of the type I discrete sine
+	 * transform.  Each mode decays exponentially towards the steady state
+	 * given by the border cells and the cell dissipation, so a step of any
+	 * length is exact in time and costs {@code O(N log N)}.
+
+	 * <p> The sine transforms are computed with a fast Fourier transform
+	 * of twice their length, radix two if that is a power of two and
+	 * Bluestein's algorithm otherwise, so no library is needed.
+	 */
+	class HeatSpectral
+	{
+		/**
+		 * Fast Fourier transform of a given length.
+		 */
+		class Fourier
+		{
+			const int length;
+			/**
+			 * Length of the radix two transforms, {@code length} or the
+			 * power of two used by Bluestein's algorithm.
+			 */
+			int size;
+			std::vector<std::complex<double> > twiddles;
+			/**
+			 * Chirp and transform of the convolution kernel of Bluestein's
+			 * algorithm, empty if {@code length} is a power of two.
+			 */
+			std::vector<std::complex<double> > chirp, kernel;
+			std::vector<std::complex<double> > work;
+		public:
+			Fourier (int length);
+			/**
+			 * Replace the given data by its forward transform.
+			 */
+			void transform (std::vector<std::complex<double> > &data);
+		private:
+			void radix2 (std::vector<std::complex<double> > &data, bool inverse) const;
+		};
+		/**
+		 * Number of interior columns and rows.
+		 */
+		const int columns, rows;
+		Fourier columnFourier, rowFourier;
+		/**
+		 * Parameters of the cached decay and gain of each mode.
+		 */
+		double conductance, loss, deltaTime;
+		std::vector<double> decay, gain;
+		/**
+		 * Interior temperatures, sources and their transforms, indexed by
+		 * {@code x*rows+y}.
+		 */
+		std::vector<double> heat, source;
+		std::vector<std::complex<double> > line;
+		std::vector<double> values;
+	public:
+		/**
+		 * Create a solver for a grid with the given number of interior
+		 * columns and rows.
+		 */
+		HeatSpectral (int columns, int rows);
+		/**
+		 * Advance the interior cells of plane {@code heat} by the given
+		 * time and write them in plane {@code next}.  Both pointers point
+		 * to cell {@code (0,0)}, interior cells are {@code [1,columns]} by
+		 * {@code [1,rows]}, and the cells around them are the fixed
+		 * boundary.  Both planes may be the same.  Parameter {@code conductance} is the conductance of
+		 * every face and {@code loss} the conductance to the outside world,
+		 * both per second.
+		 */
+		void advance (
+			const HeatValue *heat, HeatValue *next, std::ptrdiff_t stride,
+			double conductance, double loss, double normalHeat, double deltaTime);
+	private:
+		/**
+		 * Replace the given interior plane by its orthonormal two
+		 * dimensional sine transform, which is its own inverse.
+		 */
+		void transform (std::vector<double> &plane);
+		/**
+		 * Replace {@code values[0,n)} by their orthonormal sine transform.
+		 */
+		void sineTransform (Fourier &fourier, int n);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cmath>
+
+#include "HeatSuperposition.h"
+
+using namespace Enki;
+
+HeatSuperposition::
+HeatSuperposition (const GridLayout &layout):
+	layout (layout),
+	cells (layout.index (layout.sizeX - 1, layout.sizeY - 1) + 1),
+	step (0)
+{
+}
+
+int HeatSuperposition::
+addActuator (const void *owner, const std::vector<std::ptrdiff_t> &cells, const std::vector<double> &steady)
+{
+	Actuator actuator;
+	actuator.owner = owner;
+	actuator.cells = cells;
+	actuator.steady.assign (steady.begin (), steady.end ());
+	actuator.value = 0;
+	actuator.settled = 0;
+	this->actuators.push_back (actuator);
+	return this->actuators.size () - 1;
+}
+
+void HeatSuperposition::
+addSample (int actuator, int step, const HeatValue *plane, const GridTile &box, double tolerance)
+{
+	Actuator &a = this->actuators [actuator];
+	a.steps.push_back (step);
+	a.samples.push_back (Sample ());
+	Sample &sample = a.samples.back ();
+	sample.box = box;
+	sample.xmin = box.xmin / BLOCK_SIZE;
+	sample.ymin = box.ymin / BLOCK_SIZE;
+	sample.rows = (box.ymax - 1) / BLOCK_SIZE + 1 - sample.ymin;
+	const int xmax = (box.xmax - 1) / BLOCK_SIZE + 1;
+	std::vector<float> deviations;
+	std::vector<float> nodes;
+	for (int bx = sample.xmin; bx < xmax; bx++) {
+		for (int by = sample.ymin; by < sample.ymin + sample.rows; by++) {
+			Block block;
+			block.cells.xmin = std::max (bx * BLOCK_SIZE, box.xmin);
+			block.cells.ymin = std::max (by * BLOCK_SIZE, box.ymin);
+			block.cells.xmax = std::min ((bx + 1) * BLOCK_SIZE, box.xmax);
+			block.cells.ymax = std::min ((by + 1) * BLOCK_SIZE, box.ymax);
+			const int width = block.cells.xmax - block.cells.xmin;
+			const int height = block.cells.ymax - block.cells.ymin;
+			deviations.resize (width * height);
+			double largest = 0;
+			for (int x = 0; x < width; x++) {
+				for (int y = 0; y < height; y++) {
+					const std::ptrdiff_t index = this->layout.index (block.cells.xmin + x, block.cells.ymin + y);
+					deviations [x * height + y] = plane [index] - a.steady [index];
+					largest = std::max (largest, (double) std::fabs (deviations [x * height + y]));
+				}
+			}
+			block.spacing = 0;
+			block.rows = 0;
+			block.offset = sample.deviations.size ();
+			if (largest > tolerance) {
+				// widest spacing within the tolerance, every cell at worst
+				for (block.spacing = BLOCK_SIZE; ; block.spacing /= 2) {
+					block.rows = (height - 1 + block.spacing - 1) / block.spacing + 1;
+					const int columns = (width - 1 + block.spacing - 1) / block.spacing + 1;
+					nodes.resize (columns * block.rows);
+					for (int i = 0; i < columns; i++) {
+						const int x = std::min (i * block.spacing, width - 1);
+						for (int j = 0; j < block.rows; j++) {
+							nodes [i * block.rows + j] = deviations [x * height + std::min (j * block.spacing, height - 1)];
+						}
+					}
+					if (block.spacing == 1) {
+						break;
+					}
+					double error = 0;
+					for (int x = 0; x < width && error <= tolerance; x++) {
+						for (int y = 0; y < height; y++) {
+							const double value = interpolate (&nodes [0], block.cells, block.spacing, block.rows, block.cells.xmin + x, block.cells.ymin + y);
+							error = std::max (error, std::fabs (value - deviations [x * height + y]));
+						}
+					}
+					if (error <= tolerance) {
+						break;
+					}
+				}
+				sample.deviations.insert (sample.deviations.end (), nodes.begin (), nodes.end ());
+			}
+			sample.blocks.push_back (block);
+		}
+	}
+}
+
+int HeatSuperposition::
+findActuator (const void *owner) const
+{
+	for (std::size_t i = 0; i < this->actuators.size (); i++) {
+		if (this->actuators [i].owner == owner) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void HeatSuperposition::
+start (const HeatValue *plane, const std::vector<double> &values)
+{
+	this->baseline.assign (plane, plane + this->cells);
+	this->step = 0;
+	for (std::size_t i = 0; i < this->actuators.size (); i++) {
+		Actuator &a = this->actuators [i];
+		a.value = values [i];
+		a.settled = 0;
+		a.changes.clear ();
+	}
+}
+
+void HeatSuperposition::
+setValue (int actuator, double value)
+{
+	Actuator &a = this->actuators [actuator];
+	if (value == a.value) {
+		return ;
+	}
+	Change change;
+	change.step = this->step;
+	change.delta = value - a.value;
+	a.value = value;
+	// changes of the same step are a single change
+	if (!a.changes.empty () && a.changes.back ().step == change.step) {
+		a.changes.back ().delta += change.delta;
+	}
+	else {
+		a.changes.push_back (change);
+	}
+}
+
+void HeatSuperposition::
+advance ()
+{
+	this->step++;
+	for (std::vector<Actuator>::iterator a = this->actuators.begin (); a != this->actuators.end (); a++) {
+		const int horizon = a->steps.back ();
+		while (!a->changes.empty () && this->step - a->changes.front ().step >= horizon) {
+			a->settled += a->changes.front ().delta;
+			a->changes.pop_front ();
+		}
+		// merge pairs of changes closer than half the sample spacing at
+		// the age of the younger one
+		std::size_t i = 0;
+		while (i + 1 < a->changes.size ()) {
+			Change &older = a->changes [i];
+			const Change &younger = a->changes [i + 1];
+			const double age = this->step - younger.step;
+			const int k = std::upper_bound (a->steps.begin (), a->steps.end (), age) - a->steps.begin ();
+			const int spacing = k < (int) a->steps.size () ? a->steps [k] - a->steps [k - 1] : horizon;
+			if ((older.delta > 0) == (younger.delta > 0) && 2 * (younger.step - older.step) <= spacing) {
+				const double delta = older.delta + younger.delta;
+				older.step = (older.step * older.delta + younger.step * younger.delta) / delta;
+				older.delta = delta;
+				a->changes.erase (a->changes.begin () + i + 1);
+			}
+			else {
+				i++;
+			}
+		}
+	}
+}
+
+double HeatSuperposition::
+evaluate (std::ptrdiff_t cell) const
+{
+	double value = this->baseline [cell];
+	for (std::vector<Actuator>::const_iterator a = this->actuators.begin (); a != this->actuators.end (); a++) {
+		value += a->settled * a->steady [cell];
+		for (std::deque<Change>::const_iterator change = a->changes.begin (); change != a->changes.end (); change++) {
+			value += change->delta * response (*a, cell, this->step - change->step);
+		}
+	}
+	return value;
+}
+
+double HeatSuperposition::
+response (const Actuator &actuator, std::ptrdiff_t cell, double age) const
+{
+	if (age < 0) {
+		return 0;
+	}
+	const int k = std::upper_bound (actuator.steps.begin (), actuator.steps.end (), age) - actuator.steps.begin ();
+	if (k == (int) actuator.steps.size ()) {
+		return actuator.steady [cell];
+	}
+	const double t = (age - actuator.steps [k - 1]) / (actuator.steps [k] - actuator.steps [k - 1]);
+	return
+		(1 - t) * sampleAt (actuator, actuator.samples [k - 1], cell)
+		+ t * sampleAt (actuator, actuator.samples [k], cell);
+}
+
+double HeatSuperposition::
+sampleAt (const Actuator &actuator, const Sample &sample, std::ptrdiff_t cell) const
+{
+	const int x = cell / this->layout.stride;
+	const int y = cell % this->layout.stride;
+	const GridTile &box = sample.box;
+	if (x < box.xmin || x >= box.xmax || y < box.ymin || y >= box.ymax) {
+		return 0;
+	}
+	const Block &block = sample.blocks [(x / BLOCK_SIZE - sample.xmin) * sample.rows + y / BLOCK_SIZE - sample.ymin];
+	if (block.spacing == 0) {
+		return actuator.steady [cell];
+	}
+	return actuator.steady [cell] + interpolate (&sample.deviations [block.offset], block.cells, block.spacing, block.rows, x, y);
+}
+
+double HeatSuperposition::
+interpolate (const float *nodes, const GridTile &cells, int spacing, int rows, int x, int y)
+{
+	// nodes around the cell, the last ones are on the edges of the block
+	const int i = (x - cells.xmin) / spacing;
+	const int j = (y - cells.ymin) / spacing;
+	const int x0 = cells.xmin + i * spacing;
+	const int y0 = cells.ymin + j * spacing;
+	const int x1 = std::min (x0 + spacing, cells.xmax - 1);
+	const int y1 = std::min (y0 + spacing, cells.ymax - 1);
+	const double tx = x1 > x0 ? (double) (x - x0) / (x1 - x0) : 0;
+	const double ty = y1 > y0 ? (double) (y - y0) / (y1 - y0) : 0;
+	const float *d = nodes + i * rows + j;
+	const int di = x1 > x0 ? rows : 0;
+	const int dj = y1 > y0 ? 1 : 0;
+	return
+		(1 - tx) * ((1 - ty) * d [0] + ty * d [dj])
+		+ tx * ((1 - ty) * d [di] + ty * d [di + dj]);
+}
@@ -0,0 +1,212 @@
+#ifndef __HEAT_SUPERPOSITION_H
+#define __HEAT_SUPERPOSITION_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "GridField.h"
+#include "GridTiling.h"
+#include "HeatKernels.h"
+
+namespace Enki
+{
+	/**
+	 * Temperature of a heat grid given as a superposition of the step
+	 * responses of its actuators.  The heat equation of {@code WorldHeat} is
+	 * linear, so while the diffusivity and the cells fixed by actuators do
+	 * not change, the temperature is a steady baseline plus the response
+	 * of the grid to each change of actuator temperature:
+
+	 * <pre>
+	 * T(i,n) = B(i) + sum_a sum_k delta(a,k) * S(a,i,n-n(a,k))
+	 * </pre>
+
+	 * <p> where {@code B} is the baseline, {@code delta(a,k)} is the change
+	 * of temperature of actuator {@code a} at step {@code n(a,k)} and {@code
+	 * S(a,i,m)} is the temperature of cell {@code i} after {@code m} steps
+	 * of a grid at zero with the cells of actuator {@code a} at one and the
+	 * cells of the other actuators at zero.
+
+	 * <p> Responses are sampled at increasingly spaced steps, since they
+	 * change fast at first and slowly later, and interpolated between
+	 * samples.  Past the last sample a response is taken as its steady
+	 * state, and changes older than that are folded in a single term.
+	 * Steady responses are kept for every cell.  A sample only keeps the
+	 * rectangle that heat reached since the step, outside of which the
+	 * response is zero.  Its difference with the steady response is kept
+	 * by blocks of cells, not at all where it is negligible, and elsewhere
+	 * at the widest spacing of cells whose bilinear interpolation is
+	 * within the tolerance given by the caller.
+	 * Consecutive changes of the same sign closer than the sample spacing
+	 * at their age are merged.  The cost of evaluating a cell is thus
+	 * proportional to the number of actuators and recent changes, not to
+	 * the size of the grid.
+
+	 * <p> Cells are given by their index in the planes of the grid.
+	 */
+	class HeatSuperposition
+	{
+		struct Change
+		{
+			/**
+			 * Step of the change, not an integer after merging.
+			 */
+			double step;
+			double delta;
+		};
+		/**
+		 * Difference between a response and its steady state in a block of
+		 * cells, kept at the cells whose offset from the lower left corner
+		 * of the block is a multiple of {@code spacing}, and at its upper
+		 * and right edges.  Node {@code (i,j)} is at index {@code
+		 * offset+i*rows+j} of the deviations of the sample.  A spacing of
+		 * zero means the difference is negligible.
+		 */
+		struct Block
+		{
+			GridTile cells;
+			int spacing;
+			int rows;
+			std::size_t offset;
+		};
+		/**
+		 * Sample of a response in rectangle {@code box}.  The blocks of the
+		 * sample are the intersections of the box with the squares of
+		 * {@code BLOCK_SIZE} cells aligned with the grid, from square
+		 * {@code (xmin,ymin)}, column major.
+		 */
+		struct Sample
+		{
+			GridTile box;
+			int xmin;
+			int ymin;
+			int rows;
+			std::vector<Block> blocks;
+			std::vector<float> deviations;
+		};
+		struct Actuator
+		{
+			const void *owner;
+			std::vector<std::ptrdiff_t> cells;
+			/**
+			 * Steps of the response samples, the first is zero.
+			 */
+			std::vector<int> steps;
+			std::vector<Sample> samples;
+			std::vector<float> steady;
+			/**
+			 * Current temperature.
+			 */
+			double value;
+			/**
+			 * Sum of the changes older than the last response sample.
+			 */
+			double settled;
+			std::deque<Change> changes;
+		};
+		const GridLayout layout;
+		const std::size_t cells;
+		std::vector<Actuator> actuators;
+		std::vector<HeatValue> baseline;
+		/**
+		 * Number of steps since the baseline.
+		 */
+		long step;
+	public:
+		/**
+		 * Create an empty superposition of planes of the given layout.
+		 */
+		HeatSuperposition (const GridLayout &layout);
+		/**
+		 * Add an actuator with the given owner, cells and steady response,
+		 * and return its index.
+		 */
+		int addActuator (const void *owner, const std::vector<std::ptrdiff_t> &cells, const std::vector<double> &steady);
+		/**
+		 * Side of the squares of cells where a sample chooses its spacing.
+		 */
+		static const int BLOCK_SIZE = 16;
+		/**
+		 * Add a sample of the response of the given actuator after the
+		 * given number of steps, zero outside the given rectangle, kept
+		 * within the given tolerance.  Samples are added in increasing
+		 * order of steps, starting at zero.
+		 */
+		void addSample (int actuator, int step, const HeatValue *plane, const GridTile &box, double tolerance);
+		/**
+		 * Return the number of actuators.
+		 */
+		int size () const
+		{
+			return this->actuators.size ();
+		}
+		/**
+		 * Return the owner of the given actuator.
+		 */
+		const void *getOwner (int actuator) const
+		{
+			return this->actuators [actuator].owner;
+		}
+		/**
+		 * Return the cells of the given actuator.
+		 */
+		const std::vector<std::ptrdiff_t> &getCells (int actuator) const
+		{
+			return this->actuators [actuator].cells;
+		}
+		/**
+		 * Return the steady response of the given actuator at the given
+		 * cell.
+		 */
+		double getSteady (int actuator, std::ptrdiff_t cell) const
+		{
+			return this->actuators [actuator].steady [cell];
+		}
+		/**
+		 * Return the index of the actuator with the given owner, or -1.
+		 */
+		int findActuator (const void *owner) const;
+		/**
+		 * Start a superposition from the given steady plane, with the given
+		 * temperatures of the actuators.
+		 */
+		void start (const HeatValue *plane, const std::vector<double> &values);
+		/**
+		 * Record the temperature of the given actuator at the current step.
+		 */
+		void setValue (int actuator, double value);
+		/**
+		 * Advance one step, folding and merging old changes.
+		 */
+		void advance ();
+		/**
+		 * Return the temperature of the given cell at the current step.
+		 */
+		double evaluate (std::ptrdiff_t cell) const;
+	private:
+		/**
+		 * Return the response of the given actuator at the given cell after
+		 * the given number of steps.
+		 */
+		double response (const Actuator &actuator, std::ptrdiff_t cell, double age) const;
+		/**
+		 * Return the given sample of the response of the given actuator at
+		 * the given cell.
+		 */
+		double sampleAt (const Actuator &actuator, const Sample &sample, std::ptrdiff_t cell) const;
+		/**
+		 * Return the interpolation of the nodes of a block at cell {@code
+		 * (x,y)}.
+		 */
+		static double interpolate (const float *nodes, const GridTile &cells, int spacing, int rows, int x, int y);
+	};
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// mode: flyspell-prog
+// ispell-local-dictionary: "british"
+// End:
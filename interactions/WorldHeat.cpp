@@ -1,7 +1,20 @@
+#include <cmath>
 #include <limits>
+#include <cstring>
+#include <sstream>
 #include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef Q_MOC_RUN
+#include <boost/thread/tss.hpp>
+#endif
 
 #include "WorldHeat.h"
+#include "HeatMultigrid.h"
 
 using namespace Enki;
 using namespace std;
@@ -9,51 +22,284 @@ using namespace std;
 const double WorldHeat::THERMAL_DIFFUSIVITY_AIR = 1.9e-5;
 const double WorldHeat::THERMAL_DIFFUSIVITY_COPPER = 1.11e-4;
 /*const*/ double WorldHeat::CELL_DISSIPATION = 1e-6;
+string WorldHeat::KERNEL = "auto";
+const int WorldHeat::TEMPORAL_BLOCK_WIDTH = 32;
+string WorldHeat::SOLVER = "explicit";
+/*const*/ double WorldHeat::STEADY_STATE_THRESHOLD = 0;
+const int WorldHeat::STEADY_STATE_CHECK_PERIOD = 100;
+const double WorldHeat::FROZEN_WRITE_TOLERANCE = 1e-3;
+const double WorldHeat::EQUILIBRIUM_TOLERANCE = 1e-10;
+const int WorldHeat::EQUILIBRIUM_ITERATIONS = 500;
+/*const*/ bool WorldHeat::SUPERPOSITION = false;
+const double WorldHeat::SUPERPOSITION_TOLERANCE = 1e-4;
+const double WorldHeat::SUPERPOSITION_HORIZON = 3600;
+const double WorldHeat::SUPERPOSITION_STEADY_RATE = 1e-4;
+const double WorldHeat::SUPERPOSITION_SAMPLE_SPACING = 0.05;
+const double WorldHeat::SUPERPOSITION_SAMPLE_TOLERANCE = 1e-3;
+/*const*/ double WorldHeat::ACTIVITY_THRESHOLD = 0;
+/*const*/ bool WorldHeat::BILINEAR_SAMPLING = false;
+/*const*/ int WorldHeat::LOCAL_TIME_STEP_RATIO = 1;
+/*const*/ double WorldHeat::WARM_UP_SCALE = 1;
+const double WorldHeat::WARM_UP_STABILITY = 0.9;
+/*const*/ double WorldHeat::SPARSE_TOLERANCE = 0;
+
+/**
+ * Private buffers of the threads that run the temporally blocked update.
+ */
+static boost::thread_specific_ptr<std::vector<HeatValue> > blockBuffer;
 
 WorldHeat::
 WorldHeat (const ExtendedWorld *world, double normalHeat, double gridScale, double borderSize, double concurrencyLevel, int logRate):
 	AbstractGrid (world, gridScale, borderSize),
 #ifdef WORLDHEAT_SERIAL
-	AbstractGridSimulation (),
+	AbstractGridSimulation (WorldHeat::SPARSE_TOLERANCE <= 0),
+	AbstractGridProperties (WorldHeat::SPARSE_TOLERANCE <= 0),
 #else
-	AbstractGridParallelSimulation (concurrencyLevel, this, false),
+	// a sparse grid does not touch its planes
+	AbstractGridParallelSimulation (concurrencyLevel, this, false, WorldHeat::SPARSE_TOLERANCE <= 0),
+	AbstractGridProperties (false),
 #endif
-	AbstractGridProperties (),
-	initFlag (true),
-	normalHeat (normalHeat),
-	logStream (NULL),
+	partialAlpha (
+		100 * 100 // gridScale is in centimetres
+		/ (gridScale * gridScale)),
+	cellDissipation (WorldHeat::CELL_DISSIPATION),
 	logRate (logRate - 1),
 	iterationsToNextLog (logRate),
 	relativeTime (0),
-	partialAlpha (
-		100 * 100 // gridScale is in centimetres
-		/ (gridScale * gridScale))
+	kernel (HeatKernels::select (WorldHeat::KERNEL)),
+	uniformKernel (HeatKernels::uniform (this->kernel)),
+	temporalBlocking (1),
+	pendingSubsteps (0),
+	solver (WorldHeat::selectSolver (WorldHeat::SOLVER)),
+	conductanceFactor (0),
+	conductancesDirty (true),
+	frozen (false),
+	snapshotTaken (false),
+	stepsToCheck (0),
+	timeSinceSnapshot (0),
+	frozenWritesRecorded (false),
+	equilibriumRequested (false),
+	warmUpDuration (0),
+	superposition (NULL),
+	superposed (false),
+	responsesDirty (true),
+	spectral (NULL),
+	spectralFallbackReported (false),
+	superpositionDeltaTime (0),
+	stepsToSuperpose (0),
+	sampleRound (0),
+	normalHeat (normalHeat),
+	initFlag (true)
 {
+#ifdef WORLDHEAT_DIFFUSIVITY_CLASSES
+	// class zero is air, the diffusivity of cells that are never drawn
+	std::fill (this->diffusivityClasses, this->diffusivityClasses + HeatKernels::MAXIMUM_CLASSES, HeatValue (0));
+	this->numberClasses = 0;
+	this->toDiffusivity (WorldHeat::THERMAL_DIFFUSIVITY_AIR);
+#endif
+	this->initPlanes ();
+	this->initActivity ();
 }
 
 WorldHeat::
 WorldHeat (const Vector &size, const Vector &origin, double normalHeat, double gridScale, double borderSize, double concurrencyLevel, int logRate):
 	AbstractGrid (gridScale, borderSize, size, origin),
 #ifdef WORLDHEAT_SERIAL
-	AbstractGridSimulation (),
+	AbstractGridSimulation (WorldHeat::SPARSE_TOLERANCE <= 0),
+	AbstractGridProperties (WorldHeat::SPARSE_TOLERANCE <= 0),
 #else
-	AbstractGridParallelSimulation (concurrencyLevel, this, false),
+	// a sparse grid does not touch its planes
+	AbstractGridParallelSimulation (concurrencyLevel, this, false, WorldHeat::SPARSE_TOLERANCE <= 0),
+	AbstractGridProperties (false),
 #endif
-	AbstractGridProperties (),
-	initFlag (false),
-	normalHeat (normalHeat),
-	logStream (NULL),
+	partialAlpha (
+		100 * 100 // gridScale is in centimetres
+		/ (gridScale * gridScale)),
+	cellDissipation (WorldHeat::CELL_DISSIPATION),
 	logRate (logRate - 1),
 	iterationsToNextLog (logRate),
 	relativeTime (0),
-	partialAlpha (
-		100 * 100 // gridScale is in centimetres
-		/ (gridScale * gridScale))
+	kernel (HeatKernels::select (WorldHeat::KERNEL)),
+	uniformKernel (HeatKernels::uniform (this->kernel)),
+	temporalBlocking (1),
+	pendingSubsteps (0),
+	solver (WorldHeat::selectSolver (WorldHeat::SOLVER)),
+	conductanceFactor (0),
+	conductancesDirty (true),
+	frozen (false),
+	snapshotTaken (false),
+	stepsToCheck (0),
+	timeSinceSnapshot (0),
+	frozenWritesRecorded (false),
+	equilibriumRequested (false),
+	warmUpDuration (0),
+	superposition (NULL),
+	superposed (false),
+	responsesDirty (true),
+	spectral (NULL),
+	spectralFallbackReported (false),
+	superpositionDeltaTime (0),
+	stepsToSuperpose (0),
+	sampleRound (0),
+	normalHeat (normalHeat),
+	initFlag (false)
 {
+#ifdef WORLDHEAT_DIFFUSIVITY_CLASSES
+	// class zero is air, the diffusivity of cells that are never drawn
+	std::fill (this->diffusivityClasses, this->diffusivityClasses + HeatKernels::MAXIMUM_CLASSES, HeatValue (0));
+	this->numberClasses = 0;
+	this->toDiffusivity (WorldHeat::THERMAL_DIFFUSIVITY_AIR);
+#endif
+	this->initPlanes ();
+	this->initActivity ();
+}
+
+void WorldHeat::
+initPlanes ()
+{
+#ifdef WORLDHEAT_SERIAL
+	this->tiling.init (1, 1, this->size.x - 1, this->size.y - 1, GridTiling::TILE_WIDTH, GridTiling::TILE_HEIGHT);
+#endif
+	if (WorldHeat::SPARSE_TOLERANCE > 0 && this->solver == EXPLICIT && WorldHeat::LOCAL_TIME_STEP_RATIO <= 1 && this->tiling.size () > 0) {
+		// pages are committed as tiles are allocated
+		this->grid [0].reserve (this->layout);
+		this->grid [1].reserve (this->layout);
+		this->prop.reserve (this->layout);
+		this->eastConductance.reserve (this->layout);
+		this->northConductance.reserve (this->layout);
+		this->tileState.resize (this->tiling.size (), UNALLOCATED_TILE);
+		return ;
+	}
+#ifdef WORLDHEAT_SERIAL
+	if (WorldHeat::SPARSE_TOLERANCE > 0) {
+		// the base classes did not initialise the planes
+		this->grid [0].fill (HeatValue ());
+		this->grid [1].fill (HeatValue ());
+		this->prop.fill (HeatDiffusivity ());
+	}
+	this->eastConductance.resize (this->layout);
+	this->northConductance.resize (this->layout);
+	if (this->solver != EXPLICIT) {
+		this->scratch.resize (this->layout);
+	}
+#else
+	if (WorldHeat::SPARSE_TOLERANCE > 0) {
+		// the base class did not touch the planes
+		this->firstTouch (this->grid [0], HeatValue ());
+		this->firstTouch (this->grid [1], HeatValue ());
+	}
+	this->firstTouch (this->prop, HeatDiffusivity ());
+	this->eastConductance.resize (this->layout, false);
+	this->firstTouch (this->eastConductance, HeatValue ());
+	this->northConductance.resize (this->layout, false);
+	this->firstTouch (this->northConductance, HeatValue ());
+	if (this->solver != EXPLICIT) {
+		this->scratch.resize (this->layout, false);
+		this->firstTouch (this->scratch, HeatValue ());
+	}
+#endif
 }
 
+/**
+ * Header of the binary heat state format.  It is followed by the
+ * temperature plane and the diffusivity plane, each with {@code
+ * sizeX*sizeY} doubles in the order of {@code GridField}, {@code y}
+ * contiguous.  The header is 64 bytes long so that the planes of a mapped
+ * file are aligned.  Numbers are in the native byte order of the machine
+ * that wrote the file.  The version doubles as a byte order marker: read
+ * with the other byte order it is a large number, and the file is rejected.
+ */
+struct HeatStateHeader
+{
+	char magic [8];
+	uint32_t version;
+	uint32_t headerSize;
+	double borderSize;
+	double gridScale;
+	int32_t sizeX;
+	int32_t sizeY;
+	double originX;
+	double originY;
+	double normalHeat;
+};
+
+static const char HEAT_STATE_MAGIC [8] = {'A', 'S', 'I', 'S', 'H', 'E', 'A', 'T'};
+static const uint32_t HEAT_STATE_VERSION = 1;
+
 WorldHeat *WorldHeat::
 worldHeatFromFile (string filename, double concurrencyLevel, int logRate)
+{
+	const int fd = open (filename.c_str (), O_RDONLY);
+	if (fd == -1) {
+		cerr << "Could not open heat state file " << filename << '\n';
+		return NULL;
+	}
+	struct stat status;
+	void *map = MAP_FAILED;
+	if (fstat (fd, &status) == 0 && status.st_size >= (off_t) sizeof (HeatStateHeader)) {
+		map = mmap (NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close (fd);
+	if (map == MAP_FAILED) {
+		return WorldHeat::worldHeatFromTextFile (filename, concurrencyLevel, logRate);
+	}
+	const HeatStateHeader *header = static_cast<const HeatStateHeader *> (map);
+	if (memcmp (header->magic, HEAT_STATE_MAGIC, sizeof (HEAT_STATE_MAGIC)) != 0) {
+		munmap (map, status.st_size);
+		return WorldHeat::worldHeatFromTextFile (filename, concurrencyLevel, logRate);
+	}
+	const uint32_t swappedVersion =
+		(header->version >> 24) | ((header->version >> 8) & 0xff00)
+		| ((header->version << 8) & 0xff0000) | (header->version << 24);
+	if (swappedVersion == HEAT_STATE_VERSION) {
+		cerr << "Heat state file " << filename << " was written with the other byte order\n";
+		munmap (map, status.st_size);
+		return NULL;
+	}
+	// a grid scale that is not positive gives an empty grid or divides by zero
+	if (!(header->gridScale > 0) || !(header->borderSize >= 0)) {
+		cerr << "Heat state file " << filename << " has an invalid grid scale or border size\n";
+		munmap (map, status.st_size);
+		return NULL;
+	}
+	const std::ptrdiff_t cells = (std::ptrdiff_t) header->sizeX * header->sizeY;
+	if (header->version != HEAT_STATE_VERSION
+		 || header->headerSize != sizeof (HeatStateHeader)
+		 || header->sizeX <= 0 || header->sizeY <= 0
+		 || status.st_size < (off_t) (sizeof (HeatStateHeader) + 2 * cells * sizeof (double))) {
+		cerr << "Heat state file " << filename << " has an unsupported version or is truncated\n";
+		munmap (map, status.st_size);
+		return NULL;
+	}
+	WorldHeat *result = new WorldHeat
+		(Vector (header->sizeX, header->sizeY), Vector (header->originX, header->originY),
+		 header->normalHeat, header->gridScale, header->borderSize, concurrencyLevel, logRate);
+	const double *heat = reinterpret_cast<const double *> (header + 1);
+	const double *diffusivity = heat + cells;
+	for (int x = 0; x < header->sizeX; x++) {
+		const double *heatColumn = heat + (std::ptrdiff_t) x * header->sizeY;
+		const double *diffusivityColumn = diffusivity + (std::ptrdiff_t) x * header->sizeY;
+		for (int y = 0; y < header->sizeY; y++) {
+			// a sparse grid only allocates the tiles that differ from ambient air
+			if (fabs (heatColumn [y] - result->normalHeat) > WorldHeat::SPARSE_TOLERANCE
+				 || diffusivityColumn [y] != WorldHeat::THERMAL_DIFFUSIVITY_AIR) {
+				result->allocateCells (x, y, x + 1, y + 1);
+			}
+			if (!result->cellAllocated (x, y)) {
+				continue;
+			}
+			// border and inactive cells are never updated, so both planes need them
+			result->grid [0][x][y] = result->grid [1][x][y] = heatColumn [y];
+			result->prop [x][y] = result->toDiffusivity (diffusivityColumn [y]);
+		}
+	}
+	printf ("Read %ld heat cells\n", (long) cells);
+	munmap (map, status.st_size);
+	return result;
+}
+
+WorldHeat *WorldHeat::
+worldHeatFromTextFile (string filename, double concurrencyLevel, int logRate)
 {
 	ifstream ifs (filename.c_str ());
 	Vector size;
@@ -70,6 +316,7 @@ worldHeatFromFile (string filename, double concurrencyLevel, int logRate)
 	WorldHeat *result = new WorldHeat
 		(size, origin,
 		 normalHeat, gridScale, borderSize, concurrencyLevel, logRate);
+	result->allocateAllTiles ();
 	int qty = 0;
 	for (int y = 0; y < result->size.y; y++) {
 		for (int x = 0; x < result->size.x; x++) {
@@ -81,7 +328,7 @@ worldHeatFromFile (string filename, double concurrencyLevel, int logRate)
 	}
 	for (int x = 0; x < size.x; x++) {
 		for (int y = 0; y < size.y; y++) {
-			result->prop [x][y] = WorldHeat::THERMAL_DIFFUSIVITY_AIR;
+			result->prop [x][y] = result->toDiffusivity (WorldHeat::THERMAL_DIFFUSIVITY_AIR);
 		}
 	}
 	printf ("Read %d heat cells\n", qty);
@@ -92,15 +339,16 @@ worldHeatFromFile (string filename, double concurrencyLevel, int logRate)
 WorldHeat::
 ~WorldHeat ()
 {
-	if (this->logStream != NULL) {
-		cout << "Closing heat log\n";
-		this->logStream->flush ();
-		delete this->logStream;
-	}
+	this->turnOffLog ();
+	delete this->superposition;
+	delete this->spectral;
 }
 
 bool WorldHeat::validParameters (double deltaTime) const
 {
+	if (this->solver != EXPLICIT) {
+		return true;
+	}
 	double alpha = 
 		this->partialAlpha
 		* WorldHeat::THERMAL_DIFFUSIVITY_COPPER
@@ -113,7 +361,66 @@ double WorldHeat::getHeatAt (const Vector &pos) const
 {
 	int x, y;
 	toIndex (pos, x, y);
-	return this->grid [this->adtIndex][x][y];
+	if (!this->layout.contains (x, y)) {
+		return this->normalHeat;
+	}
+	return cellHeat (x, y);
+}
+
+void WorldHeat::
+getHeatAt (const std::vector<Vector> &positions, std::vector<double> &values, bool bilinear) const
+{
+	values.resize (positions.size ());
+	for (std::size_t i = 0; i < positions.size (); i++) {
+		values [i] = this->interpolateHeat (positions [i], bilinear);
+	}
+}
+
+double WorldHeat::
+sampleHeatAt (const Vector &position) const
+{
+	return this->interpolateHeat (position, WorldHeat::BILINEAR_SAMPLING);
+}
+
+double WorldHeat::
+interpolateHeat (const Vector &position, bool bilinear) const
+{
+	const double gx = (position.x - this->origin.x) / this->gridScale;
+	const double gy = (position.y - this->origin.y) / this->gridScale;
+	if (bilinear) {
+		const int x = floor (gx);
+		const int y = floor (gy);
+		if (this->layout.contains (x, y) && this->layout.contains (x + 1, y + 1)) {
+			const double tx = gx - x;
+			const double ty = gy - y;
+			return
+				(1 - tx) * ((1 - ty) * cellHeat (x, y) + ty * cellHeat (x, y + 1))
+				+ tx * ((1 - ty) * cellHeat (x + 1, y) + ty * cellHeat (x + 1, y + 1));
+		}
+	}
+	const int x = round (gx);
+	const int y = round (gy);
+	return this->layout.contains (x, y) ? cellHeat (x, y) : this->normalHeat;
+}
+
+int WorldHeat::
+requestHeatSample (const Vector &position)
+{
+	this->requestedPositions.push_back (position);
+	return this->requestedPositions.size () - 1;
+}
+
+bool WorldHeat::
+getHeatSample (int round, int index, const Vector &position, double &value) const
+{
+	if (round + 1 != this->sampleRound
+		 || index < 0 || index >= (int) this->sampledPositions.size ()
+		 || this->sampledPositions [index].x != position.x
+		 || this->sampledPositions [index].y != position.y) {
+		return false;
+	}
+	value = this->sampledHeat [index];
+	return true;
 }
 
 void WorldHeat::
@@ -121,7 +428,197 @@ setHeatAt (const Vector &pos, double value)
 {
 	int x, y;
 	toIndex (pos, x, y);
-	this->grid [this->adtIndex][x][y] = value;
+	if (!this->layout.contains (x, y)) {
+		return ;
+	}
+	this->writeHeat (this->layout.index (x, y), value);
+}
+
+void WorldHeat::
+stampCells (const Vector &centre, const std::vector<Point> &points, std::vector<std::ptrdiff_t> &cells) const
+{
+	cells.clear ();
+	for (std::vector<Point>::const_iterator point = points.begin (); point != points.end (); point++) {
+		int x, y;
+		toIndex (centre + *point, x, y);
+		if (this->layout.contains (x, y)) {
+			cells.push_back (this->layout.index (x, y));
+		}
+	}
+	std::sort (cells.begin (), cells.end ());
+	cells.erase (std::unique (cells.begin (), cells.end ()), cells.end ());
+}
+
+void WorldHeat::
+setHeatAt (const std::vector<std::ptrdiff_t> &cells, double value)
+{
+	for (std::vector<std::ptrdiff_t>::const_iterator cell = cells.begin (); cell != cells.end (); cell++) {
+		this->writeHeat (*cell, value);
+	}
+}
+
+void WorldHeat::
+writeHeat (std::ptrdiff_t index, double value)
+{
+	leaveSuperposition ();
+	allocateCell (index);
+	if (this->frozen) {
+		if (!this->frozenWritesRecorded) {
+			this->frozenWrites [index] = value;
+			return ;
+		}
+		std::map<std::ptrdiff_t, double>::const_iterator write = this->frozenWrites.find (index);
+		if (write != this->frozenWrites.end () && fabs (write->second - value) <= WorldHeat::FROZEN_WRITE_TOLERANCE) {
+			return ;
+		}
+		this->wakeUp ();
+	}
+	this->grid [this->adtIndex].data () [index] = value;
+	this->markWritten (index / this->layout.stride, index % this->layout.stride);
+}
+
+void WorldHeat::
+setFixedHeat (const void *owner, const std::vector<std::ptrdiff_t> &cells, double value)
+{
+	if (this->fixedHeat.data () == NULL) {
+		this->fixedHeat.reserve (this->layout);
+		std::vector<GridTile> regions;
+		storedRegions (regions);
+		for (std::vector<GridTile>::const_iterator r = regions.begin (); r != regions.end (); r++) {
+			for (int x = r->xmin; x < r->xmax; x++) {
+				std::fill (this->fixedHeat [x] + r->ymin, this->fixedHeat [x] + r->ymax, std::numeric_limits<HeatValue>::quiet_NaN ());
+			}
+		}
+	}
+	FixedStamps::iterator stamp = this->fixedStamps.find (owner);
+	if (stamp != this->fixedStamps.end () && stamp->second != cells) {
+		clearFixedHeat (owner);
+		stamp = this->fixedStamps.end ();
+	}
+	if (stamp == this->fixedStamps.end ()) {
+		this->fixedStamps [owner] = cells;
+	}
+	if (this->superposed) {
+		// a superposed actuator only records the change
+		const int actuator = this->superposition->findActuator (owner);
+		if (actuator >= 0) {
+			this->superposition->setValue (actuator, value);
+			for (std::vector<std::ptrdiff_t>::const_iterator cell = cells.begin (); cell != cells.end (); cell++) {
+				if (this->isActive (*cell / this->layout.stride, *cell % this->layout.stride)) {
+					this->fixedHeat.data () [*cell] = value;
+				}
+			}
+			return ;
+		}
+	}
+	for (std::vector<std::ptrdiff_t>::const_iterator cell = cells.begin (); cell != cells.end (); cell++) {
+		if (!this->isActive (*cell / this->layout.stride, *cell % this->layout.stride)) {
+			continue;
+		}
+		allocateCell (*cell);
+		this->fixedHeat.data () [*cell] = value;
+		this->updateBoundary (*cell);
+		this->writeHeat (*cell, value);
+	}
+}
+
+void WorldHeat::
+clearFixedHeat (const void *owner)
+{
+	FixedStamps::iterator stamp = this->fixedStamps.find (owner);
+	if (stamp == this->fixedStamps.end ()) {
+		return ;
+	}
+	leaveSuperposition ();
+	const std::vector<std::ptrdiff_t> cells (stamp->second);
+	this->fixedStamps.erase (stamp);
+	for (std::vector<std::ptrdiff_t>::const_iterator cell = cells.begin (); cell != cells.end (); cell++) {
+		if (!this->isActive (*cell / this->layout.stride, *cell % this->layout.stride)) {
+			continue;
+		}
+		this->fixedHeat.data () [*cell] = std::numeric_limits<HeatValue>::quiet_NaN ();
+		this->updateBoundary (*cell);
+	}
+	this->wakeUp ();
+}
+
+void WorldHeat::
+setHeatSource (const std::vector<std::ptrdiff_t> &cells, double rate)
+{
+	if (this->heatSource.data () == NULL) {
+		// zero where it is never written
+		this->heatSource.reserve (this->layout);
+	}
+	for (std::vector<std::ptrdiff_t>::const_iterator cell = cells.begin (); cell != cells.end (); cell++) {
+		if (!this->isActive (*cell / this->layout.stride, *cell % this->layout.stride)) {
+			continue;
+		}
+		allocateCell (*cell);
+		this->heatSource.data () [*cell] = rate;
+		this->updateBoundary (*cell);
+	}
+	this->wakeUp ();
+}
+
+void WorldHeat::
+updateBoundary (std::ptrdiff_t index)
+{
+	if (this->boundary.empty ()) {
+		this->boundary.resize (this->tiling.size ());
+		for (size_t i = 0; i < this->boundary.size (); i++) {
+			this->boundary [i].sources = false;
+		}
+	}
+	TileBoundary &tile = this->boundary [this->tiling.tileAt (index / this->layout.stride, index % this->layout.stride)];
+	const bool fixed = this->fixedHeat.data () != NULL && !std::isnan (this->fixedHeat.data () [index]);
+	const bool source = this->heatSource.data () != NULL && this->heatSource.data () [index] != 0;
+	std::vector<std::ptrdiff_t>::iterator position = std::lower_bound (tile.cells.begin (), tile.cells.end (), index);
+	const bool listed = position != tile.cells.end () && *position == index;
+	if ((fixed || source) && !listed) {
+		tile.cells.insert (position, index);
+	}
+	else if (!fixed && !source && listed) {
+		tile.cells.erase (position);
+	}
+	this->multirateDirty = true;
+	tile.sources = false;
+	if (this->heatSource.data () != NULL) {
+		for (std::vector<std::ptrdiff_t>::const_iterator cell = tile.cells.begin (); cell != tile.cells.end (); cell++) {
+			tile.sources = tile.sources || this->heatSource.data () [*cell] != 0;
+		}
+	}
+}
+
+void WorldHeat::
+applyBoundary (double deltaTime, HeatValue *heat, std::ptrdiff_t stride, int x0, int y0, int xmin, int ymin, int xmax, int ymax)
+{
+	if (this->boundary.empty () || xmin >= xmax || ymin >= ymax) {
+		return ;
+	}
+	const int rows = this->tiling.getRows ();
+	const int first = this->tiling.tileAt (xmin, ymin);
+	const int last = this->tiling.tileAt (xmax - 1, ymax - 1);
+	const HeatValue *fixed = this->fixedHeat.data ();
+	const HeatValue *source = this->heatSource.data ();
+	for (int column = first / rows; column <= last / rows; column++) {
+		for (int row = first % rows; row <= last % rows; row++) {
+			const TileBoundary &tile = this->boundary [column * rows + row];
+			for (std::vector<std::ptrdiff_t>::const_iterator cell = tile.cells.begin (); cell != tile.cells.end (); cell++) {
+				const int x = *cell / this->layout.stride;
+				const int y = *cell % this->layout.stride;
+				if (x < xmin || x >= xmax || y < ymin || y >= ymax) {
+					continue;
+				}
+				HeatValue &h = heat [(x - x0) * stride + (y - y0)];
+				if (fixed != NULL && !std::isnan (fixed [*cell])) {
+					h = fixed [*cell];
+				}
+				else if (source != NULL) {
+					h += source [*cell] * deltaTime;
+				}
+			}
+		}
+	}
 }
 
 double WorldHeat::
@@ -129,7 +626,10 @@ getHeatDiffusivityAt (const Point &pos) const
 {
 	int x, y;
 	toIndex (pos, x, y);
-	return this->prop [x][y];
+	if (!this->layout.contains (x, y)) {
+		return WorldHeat::THERMAL_DIFFUSIVITY_AIR;
+	}
+	return cellDiffusivity (x, y);
 }
 
 void WorldHeat::
@@ -137,7 +637,12 @@ setHeatDiffusivityAt (const Point &pos, double value)
 {
 	int x, y;
 	toIndex (pos, x, y);
-	this->prop [x][y] = value;
+	if (!this->layout.contains (x, y)) {
+		return ;
+	}
+	allocateCells (x, y, x + 1, y + 1);
+	this->prop [x][y] = this->toDiffusivity (value);
+	this->diffusivityChanged ();
 }
 
 
@@ -145,14 +650,20 @@ void WorldHeat::
 initParameters (const ExtendedWorld *world)
 {
 	if (this->initFlag) {
-		for (int x = 0; x < this->size.x; x++) {
-			for (int y = 0; y < this->size.y; y++) {
-				for (int i = 0; i < 2; i++) {
-					this->grid [i][x][y] = this->normalHeat;
+		// unallocated tiles of a sparse grid already read ambient air
+		std::vector<GridTile> regions;
+		storedRegions (regions);
+		for (std::vector<GridTile>::const_iterator r = regions.begin (); r != regions.end (); r++) {
+			for (int x = r->xmin; x < r->xmax; x++) {
+				for (int y = r->ymin; y < r->ymax; y++) {
+					for (int i = 0; i < 2; i++) {
+						this->grid [i][x][y] = this->normalHeat;
+					}
+					this->prop [x][y] = this->toDiffusivity (WorldHeat::THERMAL_DIFFUSIVITY_AIR);
 				}
-				this->prop [x][y] = WorldHeat::THERMAL_DIFFUSIVITY_AIR;
 			}
 		}
+		this->conductancesDirty = true;
 	}
 }
 
@@ -165,112 +676,1762 @@ void WorldHeat::
 computeNextState (double deltaTime)
 {
 	this->relativeTime += deltaTime;
-	if (this->logStream != NULL) {
-		if (this->iterationsToNextLog == 0) {
-			dumpState (*this->logStream);
+	for (std::vector<LogRegion>::iterator region = this->logs.begin (); region != this->logs.end (); region++) {
+		if (region->countdown == 0) {
+			region->log->record (this->relativeTime, this->grid [this->adtIndex]);
+			region->countdown = region->period - 1;
+		}
+		else {
+			region->countdown--;
+		}
+	}
+	updateHeat (deltaTime);
+	// the samples requested in this step are read by sensors in the next one
+	getHeatAt (this->requestedPositions, this->sampledHeat, WorldHeat::BILINEAR_SAMPLING);
+	this->sampledPositions.swap (this->requestedPositions);
+	this->requestedPositions.clear ();
+	this->sampleRound++;
+}
+
+void WorldHeat::
+updateHeat (double deltaTime)
+{
+	if (this->warmUpDuration > 0) {
+		solveWarmUp ();
+	}
+	if (this->equilibriumRequested) {
+		this->equilibriumRequested = false;
+		const int iterations = solveEquilibrium ();
+		if (iterations < 0) {
+			cerr << "Heat steady state did not converge in " << WorldHeat::EQUILIBRIUM_ITERATIONS << " iterations\n";
 		}
 		else {
-			this->iterationsToNextLog--;
+			cout << "Heat steady state solved in " << iterations << " iterations\n";
+		}
+	}
+	if (this->superposed) {
+		if (deltaTime == this->superpositionDeltaTime) {
+			this->superposition->advance ();
+			return ;
+		}
+		leaveSuperposition ();
+	}
+	if (WorldHeat::SUPERPOSITION) {
+		this->stepsToSuperpose--;
+		// substeps grouped with the following ones must be run first
+		if (this->stepsToSuperpose <= 0 && this->pendingSubsteps == 0) {
+			this->stepsToSuperpose = WorldHeat::STEADY_STATE_CHECK_PERIOD;
+			trySuperposition (deltaTime);
+			if (this->superposed) {
+				this->superposition->advance ();
+				return ;
+			}
 		}
 	}
+	if (this->frozen) {
+		this->frozenWritesRecorded = true;
+		return ;
+	}
+	if (WorldHeat::STEADY_STATE_THRESHOLD > 0) {
+		checkSteadyState (deltaTime);
+		if (this->frozen) {
+			this->pendingSubsteps = 0;
+			return ;
+		}
+	}
+	this->pendingSubsteps++;
+	if (this->pendingSubsteps < (this->localTimeStepRatio > 1 ? this->localTimeStepRatio : this->temporalBlocking)) {
+		return ;
+	}
+	const int substeps = this->pendingSubsteps;
+	this->pendingSubsteps = 0;
+	if (this->solver == ADI) {
+		updateImplicit (substeps * deltaTime);
+		return ;
+	}
+	if (this->solver == SPECTRAL) {
+		updateSpectral (substeps * deltaTime);
+		return ;
+	}
+	prepareConductances (this->partialAlpha * deltaTime);
+	if (this->localTimeStepRatio > 1) {
+		updateMultirate (deltaTime);
+		return ;
+	}
+	const std::vector<int> *tiles = selectTiles (substeps);
 #ifdef WORLDHEAT_SERIAL
-	const int nextAdtIndex = 1 - this->adtIndex;
-	const double alpha = this->partialAlpha * deltaTime;
-	for (int x = 1; x < this->size.x - 1; x++) {
-		for (int y = 1; y < this->size.y - 1; y++) {
-			const double currentHeat = this->grid [this->adtIndex][x][y];
-			const double deltaHeat =
-				(
-				 + (this->grid [this->adtIndex][x][y + 1] - currentHeat) * this->prop [x][y + 1]
-				 + (this->grid [this->adtIndex][x][y - 1] - currentHeat) * this->prop [x][y - 1]
-				 + (this->grid [this->adtIndex][x + 1][y] - currentHeat) * this->prop [x + 1][y]
-				 + (this->grid [this->adtIndex][x - 1][y] - currentHeat) * this->prop [x - 1][y]
-				 + (this->normalHeat - currentHeat ) * CELL_DISSIPATION
-				 ) * alpha
-				;
-			this->grid [nextAdtIndex][x][y] =
-				this->grid [this->adtIndex][x][y] + deltaHeat;
-		}
-	}
-	this->adtIndex = nextAdtIndex;
+	if (tiles == NULL) {
+		for (int i = 0; i < this->tiling.size (); i++) {
+			updateTile (deltaTime, substeps, i);
+		}
+	}
+	else {
+		for (size_t i = 0; i < tiles->size (); i++) {
+			updateTile (deltaTime, substeps, (*tiles) [i]);
+		}
+	}
+	this->adtIndex = 1 - this->adtIndex;
 #else
-	AbstractGridParallelSimulation::updateState (deltaTime);
+	AbstractGridParallelSimulation::updateState (deltaTime, substeps, tiles);
 #endif
 }
 
 void WorldHeat::
-updateGrid (double deltaTime, int xmin, int ymin, int xmax, int ymax)
+initActivity ()
 {
-	const int nextAdtIndex = 1 - this->adtIndex;
-	const double alpha = this->partialAlpha * deltaTime;
+	this->activeTiles.clear ();
+	for (int i = 0; i < this->tiling.size (); i++) {
+		const GridTile &t = this->tiling [i];
+		GridTile block;
+		int x = t.xmin;
+		if (this->nextActiveBlock (x, t.xmax, t.ymin, t.ymax, block)) {
+			this->activeTiles.push_back (i);
+		}
+	}
+	if ((int) this->activeTiles.size () == this->tiling.size ()) {
+		this->activeTiles.clear ();
+	}
+	this->localTimeStepRatio = this->solver == EXPLICIT ? std::max (1, WorldHeat::LOCAL_TIME_STEP_RATIO) : 1;
+	this->multirateDirty = true;
+	this->multirateSource = NULL;
+	this->multirateTarget = NULL;
+	this->multirateDeltaTime = 0;
+	this->activity.clear ();
+	if (WorldHeat::ACTIVITY_THRESHOLD > 0 && this->solver == EXPLICIT && this->localTimeStepRatio == 1) {
+		TileActivity active = {0, true, false, true};
+		this->activity.resize (this->tiling.size (), active);
+		this->updatedTiles.reserve (this->tiling.size ());
+	}
+}
+
+const std::vector<int> *WorldHeat::
+selectTiles (int substeps)
+{
+	// a change travels one cell per substep, it must not cross a tile
+	const bool skipping = substeps <= this->tiling.minimumSide ();
+	if (!this->tileState.empty ()) {
+		if (skipping) {
+			growLiveTiles (substeps);
+		}
+		else {
+			allocateAllTiles ();
+		}
+	}
+	// a sparse grid only updates its live tiles
+	const std::vector<int> *candidates =
+		!this->tileState.empty () ? &this->liveTiles
+		: this->activeTiles.empty () ? NULL
+		: &this->activeTiles;
+	if (this->activity.empty ()) {
+		return candidates;
+	}
+	const int rows = this->tiling.getRows ();
+	const int columns = this->tiling.getColumns ();
+	this->updatedTiles.clear ();
+	const int count = candidates == NULL ? this->activity.size () : candidates->size ();
+	for (int k = 0; k < count; k++) {
+		const int i = candidates == NULL ? k : (*candidates) [k];
+		TileActivity &tile = this->activity [i];
+		const int column = i / rows;
+		const int row = i % rows;
+		tile.update =
+			!skipping
+			|| (!this->boundary.empty () && this->boundary [i].sources)
+			|| tileChanging (i)
+			// a written tile has no delta yet but its change spreads now
+			|| (column > 0 && tileChanging (i - rows))
+			|| (column < columns - 1 && tileChanging (i + rows))
+			|| (row > 0 && tileChanging (i - 1))
+			|| (row < rows - 1 && tileChanging (i + 1))
+			;
+		if (tile.update || !tile.skipped) {
+			this->updatedTiles.push_back (i);
+		}
+	}
+	for (int i = 0; i < (int) this->activity.size (); i++) {
+		this->activity [i].written = false;
+	}
+	return &this->updatedTiles;
+}
+
+void WorldHeat::
+growLiveTiles (int substeps)
+{
+	const int rows = this->tiling.getRows ();
+	const int columns = this->tiling.getColumns ();
+	const GridField<HeatValue> &heat = this->grid [this->adtIndex];
+	// tiles made live here have ambient temperature, they are checked
+	// from the next update
+	const size_t count = this->liveTiles.size ();
+	for (size_t k = 0; k < count; k++) {
+		const int i = this->liveTiles [k];
+		const GridTile &t = this->tiling [i];
+		const int column = i / rows;
+		const int row = i % rows;
+		for (int c = std::max (0, column - 1); c <= std::min (columns - 1, column + 1); c++) {
+			for (int r = std::max (0, row - 1); r <= std::min (rows - 1, row + 1); r++) {
+				const int j = c * rows + r;
+				if (this->tileState [j] == LIVE_TILE) {
+					continue;
+				}
+				// cells of tile i whose heat can reach tile j in this update
+				const GridTile &n = this->tiling [j];
+				const int xmin = std::max (t.xmin, n.xmin - substeps);
+				const int ymin = std::max (t.ymin, n.ymin - substeps);
+				const int xmax = std::min (t.xmax, n.xmax + substeps);
+				const int ymax = std::min (t.ymax, n.ymax + substeps);
+				bool reached = false;
+				for (int x = xmin; x < xmax && !reached; x++) {
+					const HeatValue *h = heat [x];
+					for (int y = ymin; y < ymax; y++) {
+						if (fabs (h [y] - this->normalHeat) > WorldHeat::SPARSE_TOLERANCE) {
+							reached = true;
+							break;
+						}
+					}
+				}
+				if (reached) {
+					activateTile (j);
+				}
+			}
+		}
+	}
+}
+
+void WorldHeat::
+allocateCells (int xmin, int ymin, int xmax, int ymax)
+{
+	if (this->tileState.empty ()) {
+		return ;
+	}
+	xmin = std::max (0, xmin);
+	ymin = std::max (0, ymin);
+	xmax = std::min ((int) this->size.x, xmax);
+	ymax = std::min ((int) this->size.y, ymax);
+	if (xmin >= xmax || ymin >= ymax) {
+		return ;
+	}
+	const int rows = this->tiling.getRows ();
+	const int first = this->tiling.tileAt (xmin, ymin);
+	const int last = this->tiling.tileAt (xmax - 1, ymax - 1);
+	for (int column = first / rows; column <= last / rows; column++) {
+		for (int row = first % rows; row <= last % rows; row++) {
+			activateTile (column * rows + row);
+		}
+	}
+}
+
+void WorldHeat::
+allocateTile (int tile)
+{
+	if (this->tileState [tile] != UNALLOCATED_TILE) {
+		return ;
+	}
+	this->tileState [tile] = ALLOCATED_TILE;
+	int xmin, ymin, xmax, ymax;
+	tileCells (tile, xmin, ymin, xmax, ymax);
+	const HeatValue normal = this->normalHeat;
+	const HeatDiffusivity air = this->toDiffusivity (WorldHeat::THERMAL_DIFFUSIVITY_AIR);
+	// the heat source plane is reserved, and zero where it was never written
 	for (int x = xmin; x < xmax; x++) {
-		for (int y = ymin; y < ymax; y++) {
-			const double currentHeat = this->grid [this->adtIndex][x][y];
-			const double deltaHeat =
-				(
-				 + (this->grid [this->adtIndex][x][y + 1] - currentHeat) * this->prop [x][y + 1]
-				 + (this->grid [this->adtIndex][x][y - 1] - currentHeat) * this->prop [x][y - 1]
-				 + (this->grid [this->adtIndex][x + 1][y] - currentHeat) * this->prop [x + 1][y]
-				 + (this->grid [this->adtIndex][x - 1][y] - currentHeat) * this->prop [x - 1][y]
-				 + (this->normalHeat - currentHeat ) * CELL_DISSIPATION
-				 ) * alpha
-				;
-			this->grid [nextAdtIndex][x][y] =
-				this->grid [this->adtIndex][x][y] + deltaHeat;
+		std::fill (this->grid [0][x] + ymin, this->grid [0][x] + ymax, normal);
+		std::fill (this->grid [1][x] + ymin, this->grid [1][x] + ymax, normal);
+		std::fill (this->prop [x] + ymin, this->prop [x] + ymax, air);
+		if (this->fixedHeat.data () != NULL) {
+			std::fill (this->fixedHeat [x] + ymin, this->fixedHeat [x] + ymax, std::numeric_limits<HeatValue>::quiet_NaN ());
 		}
+		if (this->snapshot.data () != NULL) {
+			std::fill (this->snapshot [x] + ymin, this->snapshot [x] + ymax, normal);
+		}
+	}
+	if (!this->conductancesDirty) {
+		computeTileConductances (tile);
 	}
 }
 
 void WorldHeat::
-saveState (std::string filename) const
+activateTile (int tile)
 {
-	ofstream ofs (filename.c_str (), std::ofstream::out | std::ofstream::trunc);
-	ofs << "borderSize " << this->borderSize << '\n';
-	ofs << "gridScale " << this->gridScale << '\n';
-	ofs << "size " << this->size.x << ' ' << this->size.y << '\n';
-	ofs << "origin "<< this->origin.x << ' ' << this->origin.y << '\n';
-	ofs << "normalHeat " << this->normalHeat<< '\n';
-	int ai = this->adtIndex;
-	for (int y = 0; y < this->size.y; y++) {
-		for (int x = 0; x < this->size.x; x++) {
-			ofs << ' ' << this->grid [ai][x][y];
+	if (this->tileState [tile] == LIVE_TILE) {
+		return ;
+	}
+	const int rows = this->tiling.getRows ();
+	const int columns = this->tiling.getColumns ();
+	const int column = tile / rows;
+	const int row = tile % rows;
+	// the update of a tile reads its neighbours
+	for (int c = std::max (0, column - 1); c <= std::min (columns - 1, column + 1); c++) {
+		for (int r = std::max (0, row - 1); r <= std::min (rows - 1, row + 1); r++) {
+			allocateTile (c * rows + r);
 		}
-		ofs << '\n';
 	}
-	ofs.close ();
+	this->tileState [tile] = LIVE_TILE;
+	const GridTile &t = this->tiling [tile];
+	GridTile block;
+	int x = t.xmin;
+	if (this->nextActiveBlock (x, t.xmax, t.ymin, t.ymax, block)) {
+		this->liveTiles.push_back (tile);
+	}
+	if (!this->activity.empty ()) {
+		this->activity [tile].written = true;
+	}
 }
 
 void WorldHeat::
-dumpState (ostream &os)
+allocateAllTiles ()
 {
-#ifdef DUMP_MATRIX
-	for (int y = 1; y < this->size.y - 1; y++) {
-		os << this->grid [this->adtIndex][1][y];
-		for (int x = 2; x < this->size.x - 1; x++) {
-			os << '\t' << this->grid [this->adtIndex][x][y];
+	if (this->tileState.empty ()) {
+		return ;
+	}
+	for (int i = 0; i < this->tiling.size (); i++) {
+		allocateTile (i);
+	}
+	this->tileState.clear ();
+	this->liveTiles.clear ();
+}
+
+void WorldHeat::
+tileCells (int tile, int &xmin, int &ymin, int &xmax, int &ymax) const
+{
+	const GridTile &t = this->tiling [tile];
+	xmin = t.xmin == 1 ? 0 : t.xmin;
+	ymin = t.ymin == 1 ? 0 : t.ymin;
+	xmax = t.xmax == this->size.x - 1 ? this->size.x : t.xmax;
+	ymax = t.ymax == this->size.y - 1 ? this->size.y : t.ymax;
+}
+
+void WorldHeat::
+storedRegions (std::vector<GridTile> &regions) const
+{
+	regions.clear ();
+	if (this->tileState.empty ()) {
+		const GridTile all = {0, 0, (int) this->size.x, (int) this->size.y};
+		regions.push_back (all);
+		return ;
+	}
+	for (int i = 0; i < this->tiling.size (); i++) {
+		if (this->tileState [i] != UNALLOCATED_TILE) {
+			GridTile region;
+			tileCells (i, region.xmin, region.ymin, region.xmax, region.ymax);
+			regions.push_back (region);
 		}
-		os << '\n';
 	}
-	os << '\n';
-#endif
-// #ifdef DUMP_LINE
-	os << this->relativeTime;
-	for (int y = 1; y < this->size.y - 1; y++) {
-		for (int x = 1; x < this->size.x - 1; x++) {
-			os << '\t' << this->grid [this->adtIndex][x][y];
+}
+
+void WorldHeat::
+updateTile (double deltaTime, int substeps, int tile)
+{
+	const GridTile &t = this->tiling [tile];
+	const GridField<HeatValue> &current = this->grid [this->adtIndex];
+	GridField<HeatValue> &next = this->grid [1 - this->adtIndex];
+	if (!this->activity.empty ()) {
+		TileActivity &a = this->activity [tile];
+		if (!a.update) {
+			if (!a.skipped) {
+				for (int x = t.xmin; x < t.xmax; x++) {
+					std::copy (current [x] + t.ymin, current [x] + t.ymax, next [x] + t.ymin);
+				}
+				a.skipped = true;
+			}
+			a.maxDelta = 0;
+			return ;
+		}
+		a.skipped = false;
+	}
+	if (substeps == 1 && this->tileConductance [tile] >= 0) {
+		GridTile block;
+		int x = t.xmin;
+		while (this->nextActiveBlock (x, t.xmax, t.ymin, t.ymax, block)) {
+			this->uniformKernel (
+				current.data (),
+				this->tileConductance [tile],
+				next.data (),
+				this->layout.stride,
+				block.xmin, block.ymin, block.xmax, block.ymax,
+				this->normalHeat,
+				this->conductanceFactor * this->cellDissipation);
 		}
 	}
-	os << '\n';
-// #endif
-	this->iterationsToNextLog = this->logRate;
+	else if (substeps == 1) {
+		updateGrid (deltaTime, t.xmin, t.ymin, t.xmax, t.ymax);
+	}
+	else {
+		updateGridBlocked (deltaTime, substeps, t.xmin, t.ymin, t.xmax, t.ymax);
+	}
+	if (substeps == 1) {
+		applyBoundary (deltaTime, next.data (), this->layout.stride, 0, 0, t.xmin, t.ymin, t.xmax, t.ymax);
+	}
+	if (!this->activity.empty ()) {
+		double maxDelta = 0;
+		for (int x = t.xmin; x < t.xmax; x++) {
+			const HeatValue *c = current [x];
+			const HeatValue *n = next [x];
+			for (int y = t.ymin; y < t.ymax; y++) {
+				maxDelta = std::max (maxDelta, (double) fabs (n [y] - c [y]));
+			}
+		}
+		this->activity [tile].maxDelta = maxDelta;
+	}
 }
 
 void WorldHeat::
-resetTemperature (double value)
+updateGrid (double deltaTime, int xmin, int ymin, int xmax, int ymax)
 {
-	for (int x = this->size.x - 1; x >= 0; x--) {
-		for (int y = this->size.y - 1; y >= 0; y--) {
-			this->grid [this->adtIndex][x][y] = value;
+	GridTile block;
+	int x = xmin;
+	while (this->nextActiveBlock (x, xmax, ymin, ymax, block)) {
+		this->kernel (
+			this->grid [this->adtIndex].data (),
+			this->eastConductance.data (),
+			this->northConductance.data (),
+			this->grid [1 - this->adtIndex].data (),
+			this->layout.stride,
+			block.xmin, block.ymin, block.xmax, block.ymax,
+			this->normalHeat,
+			this->conductanceFactor * this->cellDissipation);
+	}
+}
+
+void WorldHeat::
+updateGridBlocked (double deltaTime, int substeps, int xmin, int ymin, int xmax, int ymax)
+{
+	for (int x = xmin; x < xmax; x += WorldHeat::TEMPORAL_BLOCK_WIDTH) {
+		updateBlock (
+			deltaTime, substeps,
+			x, ymin,
+			std::min (x + WorldHeat::TEMPORAL_BLOCK_WIDTH, xmax), ymax);
+	}
+}
+
+void WorldHeat::
+updateBlock (double deltaTime, int substeps, int xmin, int ymin, int xmax, int ymax)
+{
+	// region copied to the private buffer: block plus halo
+	const int cxmin = std::max (0, xmin - substeps);
+	const int cymin = std::max (0, ymin - substeps);
+	const int cxmax = std::min ((int) this->size.x, xmax + substeps);
+	const int cymax = std::min ((int) this->size.y, ymax + substeps);
+	const int height = cymax - cymin;
+	const std::size_t cells = (std::size_t) (cxmax - cxmin) * height;
+	if (blockBuffer.get () == NULL) {
+		blockBuffer.reset (new std::vector<HeatValue> ());
+	}
+	std::vector<HeatValue> &buffer = *blockBuffer;
+	if (buffer.size () < 4 * cells) {
+		buffer.resize (4 * cells);
+	}
+	HeatValue *local [2] = {&buffer [0], &buffer [cells]};
+	HeatValue *east = &buffer [2 * cells];
+	HeatValue *north = &buffer [3 * cells];
+	// border cells are never updated, so both local planes need them
+	for (int x = cxmin; x < cxmax; x++) {
+		const std::ptrdiff_t offset = (x - cxmin) * height;
+		const HeatValue *heat = this->grid [this->adtIndex][x] + cymin;
+		std::copy (heat, heat + height, local [0] + offset);
+		std::copy (heat, heat + height, local [1] + offset);
+		const HeatValue *e = this->eastConductance [x] + cymin;
+		std::copy (e, e + height, east + offset);
+		const HeatValue *n = this->northConductance [x] + cymin;
+		std::copy (n, n + height, north + offset);
+	}
+	// each substep updates a region one cell smaller than the previous
+	const double loss = this->conductanceFactor * this->cellDissipation;
+	int current = 0;
+	for (int s = substeps - 1; s >= 0; s--) {
+		const int uxmin = std::max (1, xmin - s);
+		const int uymin = std::max (1, ymin - s);
+		const int uxmax = std::min ((int) this->size.x - 1, xmax + s);
+		const int uymax = std::min ((int) this->size.y - 1, ymax + s);
+		GridTile block;
+		int x = uxmin;
+		while (this->nextActiveBlock (x, uxmax, uymin, uymax, block)) {
+			this->kernel (
+				local [current], east, north, local [1 - current],
+				height,
+				block.xmin - cxmin, block.ymin - cymin, block.xmax - cxmin, block.ymax - cymin,
+				this->normalHeat, loss);
+		}
+		applyBoundary (deltaTime, local [1 - current], height, cxmin, cymin, uxmin, uymin, uxmax, uymax);
+		current = 1 - current;
+	}
+	// write back the block
+	const int nextAdtIndex = 1 - this->adtIndex;
+	for (int x = xmin; x < xmax; x++) {
+		const HeatValue *heat = local [current] + (x - cxmin) * height + (ymin - cymin);
+		std::copy (heat, heat + (ymax - ymin), this->grid [nextAdtIndex][x] + ymin);
+	}
+}
+
+void WorldHeat::
+checkSteadyState (double deltaTime)
+{
+	GridField<HeatValue> &current = this->grid [this->adtIndex];
+	if (!this->snapshotTaken) {
+		if (this->snapshot.data () == NULL) {
+			// tiles allocated later write their ambient air in it
+			this->snapshot.reserve (this->layout);
+		}
+		std::vector<GridTile> regions;
+		storedRegions (regions);
+		for (std::vector<GridTile>::const_iterator r = regions.begin (); r != regions.end (); r++) {
+			for (int x = r->xmin; x < r->xmax; x++) {
+				std::copy (current [x] + r->ymin, current [x] + r->ymax, this->snapshot [x] + r->ymin);
+			}
+		}
+		this->snapshotTaken = true;
+		this->stepsToCheck = WorldHeat::STEADY_STATE_CHECK_PERIOD;
+		this->timeSinceSnapshot = 0;
+		return ;
+	}
+	this->timeSinceSnapshot += deltaTime;
+	this->stepsToCheck--;
+	if (this->stepsToCheck > 0) {
+		return ;
+	}
+	// compare with the snapshot and start a new check period
+	double maxChange = 0;
+	std::vector<GridTile> regions;
+	storedRegions (regions);
+	for (std::vector<GridTile>::const_iterator r = regions.begin (); r != regions.end (); r++) {
+		for (int x = std::max (1, r->xmin); x < std::min ((int) this->size.x - 1, r->xmax); x++) {
+			const HeatValue *h = current [x];
+			HeatValue *s = this->snapshot [x];
+			for (int y = std::max (1, r->ymin); y < std::min ((int) this->size.y - 1, r->ymax); y++) {
+				maxChange = std::max (maxChange, (double) fabs (h [y] - s [y]));
+				s [y] = h [y];
+			}
+		}
+	}
+	const double rate = maxChange / this->timeSinceSnapshot;
+	this->stepsToCheck = WorldHeat::STEADY_STATE_CHECK_PERIOD;
+	this->timeSinceSnapshot = 0;
+	if (rate < WorldHeat::STEADY_STATE_THRESHOLD) {
+		this->frozen = true;
+		this->frozenWrites.clear ();
+		this->frozenWritesRecorded = false;
+		cout << "Heat reached steady state at time " << this->relativeTime << "s\n";
+	}
+}
+
+void WorldHeat::
+wakeUp ()
+{
+	leaveSuperposition ();
+	if (this->frozen) {
+		cout << "Heat left steady state at time " << this->relativeTime << "s\n";
+	}
+	this->frozen = false;
+	this->frozenWrites.clear ();
+	this->snapshotTaken = false;
+	for (size_t i = 0; i < this->activity.size (); i++) {
+		this->activity [i].written = true;
+	}
+}
+
+int WorldHeat::
+solveEquilibrium ()
+{
+	leaveSuperposition ();
+	// the steady state reaches every cell
+	allocateAllTiles ();
+	// conductances of the explicit equation divided by the time step,
+	// sources are already rates
+	prepareConductances (this->partialAlpha);
+	const int sizeX = this->size.x;
+	const int sizeY = this->size.y;
+	const int count = sizeX * sizeY;
+	const HeatValue *heat = this->grid [this->adtIndex].data ();
+	const HeatValue *fixed = this->fixedHeat.data ();
+	std::vector<char> unknown (count, 0);
+	std::vector<double> known (count);
+	for (int x = 0; x < sizeX; x++) {
+		for (int y = 0; y < sizeY; y++) {
+			const std::ptrdiff_t index = this->layout.index (x, y);
+			const int i = x * sizeY + y;
+			if (fixed != NULL && !std::isnan (fixed [index])) {
+				known [i] = fixed [index];
+			}
+			else {
+				unknown [i] = this->isActive (x, y);
+				known [i] = heat [index];
+			}
+		}
+	}
+	const int iterations = solveSteadyState (unknown, known, this->heatSource.data (), this->normalHeat);
+	// fixed cells take their temperature, inactive cells keep theirs
+	for (int i = 0; i < 2; i++) {
+		for (int x = 0; x < sizeX; x++) {
+			for (int y = 0; y < sizeY; y++) {
+				if (this->isActive (x, y)) {
+					this->grid [i][x][y] = known [x * sizeY + y];
+				}
+			}
+		}
+	}
+	this->wakeUp ();
+	// the grid is steady, there is no need to wait to superpose it
+	this->stepsToSuperpose = 0;
+	return iterations;
+}
+
+void WorldHeat::
+solveWarmUp ()
+{
+	const double duration = this->warmUpDuration;
+	this->warmUpDuration = 0;
+	leaveSuperposition ();
+	const double scale = WorldHeat::WARM_UP_SCALE;
+	if (scale <= this->gridScale) {
+		cerr << "Heat warm-up scale " << scale << " is not coarser than grid scale " << this->gridScale << '\n';
+		return ;
+	}
+	// the coarse grid shares the worker threads of this grid, and uses the
+	// plain explicit solver whatever the solver of this grid
+	const std::string savedSolver = WorldHeat::SOLVER;
+	const int savedRatio = WorldHeat::LOCAL_TIME_STEP_RATIO;
+	const bool savedSuperposition = WorldHeat::SUPERPOSITION;
+	WorldHeat::SOLVER = "explicit";
+	WorldHeat::LOCAL_TIME_STEP_RATIO = 1;
+	WorldHeat coarse (
+		Vector (ceil ((this->size.x - 1) * this->gridScale / scale) + 1, ceil ((this->size.y - 1) * this->gridScale / scale) + 1),
+		this->origin, this->normalHeat, scale, this->borderSize, -1);
+	WorldHeat::SOLVER = savedSolver;
+	WorldHeat::LOCAL_TIME_STEP_RATIO = savedRatio;
+	coarse.cellDissipation = this->cellDissipation * this->partialAlpha / coarse.partialAlpha;
+	coarse.allocateAllTiles ();
+	const HeatValue *fixed = this->fixedHeat.data ();
+	const HeatValue *source = this->heatSource.data ();
+	coarse.fixedHeat.resize (coarse.layout);
+	coarse.fixedHeat.fill (std::numeric_limits<HeatValue>::quiet_NaN ());
+	if (source != NULL) {
+		coarse.heatSource.resize (coarse.layout);
+	}
+	for (int cx = 0; cx < coarse.size.x; cx++) {
+		for (int cy = 0; cy < coarse.size.y; cy++) {
+			const Vector position (this->origin.x + cx * scale, this->origin.y + cy * scale);
+			const std::ptrdiff_t c = coarse.layout.index (cx, cy);
+			int x, y;
+			this->toIndex (position, x, y);
+			double heat = this->interpolateHeat (position, false);
+			double diffusivity = WorldHeat::THERMAL_DIFFUSIVITY_AIR;
+			double fixedSum = 0;
+			int fixedCount = 0;
+			double sourceSum = 0;
+			int count = 0;
+			if (this->isActive (x, y)) {
+				diffusivity = cellDiffusivity (x, y);
+				int xmin, ymin, xmax, ymax;
+				coveredCells (position, 0.5 * scale, xmin, ymin, xmax, ymax);
+				double heatSum = 0;
+				for (int fx = xmin; fx < xmax; fx++) {
+					for (int fy = ymin; fy < ymax; fy++) {
+						if (!this->isActive (fx, fy)) {
+							continue;
+						}
+						const std::ptrdiff_t index = this->layout.index (fx, fy);
+						heatSum += cellHeat (fx, fy);
+						count++;
+						if (!cellAllocated (fx, fy)) {
+							// ambient air, neither fixed nor a source
+							continue;
+						}
+						if (fixed != NULL && !std::isnan (fixed [index])) {
+							fixedSum += fixed [index];
+							fixedCount++;
+						}
+						if (source != NULL) {
+							sourceSum += source [index];
+						}
+					}
+				}
+				if (count > 0) {
+					heat = heatSum / count;
+				}
+			}
+			else {
+				// inactive cells keep their temperature
+				fixedSum = heat;
+				fixedCount = 1;
+			}
+			// a coarse cell is fixed if most of its cells are
+			if (2 * fixedCount < count) {
+				fixedCount = 0;
+			}
+			if (fixedCount > 0) {
+				heat = fixedSum / fixedCount;
+			}
+			coarse.grid [0][cx][cy] = coarse.grid [1][cx][cy] = heat;
+			coarse.prop [cx][cy] = coarse.toDiffusivity (diffusivity);
+			if (!coarse.isActive (cx, cy)) {
+				continue;
+			}
+			if (fixedCount > 0) {
+				coarse.fixedHeat.data () [c] = heat;
+				coarse.updateBoundary (c);
+			}
+			if (sourceSum != 0) {
+				coarse.heatSource.data () [c] = sourceSum / count;
+				coarse.updateBoundary (c);
+			}
+		}
+	}
+	// the largest stable time step of the explicit solver, with the loss
+	// of the cells, and whole groups of substeps so that none is pending
+	const double limit =
+		WorldHeat::WARM_UP_STABILITY
+		/ (coarse.partialAlpha * (4 * WorldHeat::THERMAL_DIFFUSIVITY_COPPER + coarse.cellDissipation));
+	const int group = coarse.temporalBlocking;
+	int steps = std::max (1, (int) ceil (duration / limit));
+	steps = (steps + group - 1) / group * group;
+	WorldHeat::SUPERPOSITION = false;
+	for (int i = 0; i < steps; i++) {
+		coarse.updateHeat (duration / steps);
+	}
+	WorldHeat::SUPERPOSITION = savedSuperposition;
+	resample (coarse);
+	cout << "Heat warmed up for " << duration << "s in " << steps << " steps of scale " << scale << '\n';
+}
+
+void WorldHeat::
+resample (const WorldHeat &source)
+{
+	leaveSuperposition ();
+	const HeatValue *fixed = this->fixedHeat.data ();
+	const bool restriction = this->gridScale > source.gridScale;
+	for (int x = 0; x < this->size.x; x++) {
+		for (int y = 0; y < this->size.y; y++) {
+			const std::ptrdiff_t index = this->layout.index (x, y);
+			if (!this->isActive (x, y) || (fixed != NULL && cellAllocated (x, y) && !std::isnan (fixed [index]))) {
+				continue;
+			}
+			const Vector position (this->origin.x + x * this->gridScale, this->origin.y + y * this->gridScale);
+			double value = source.interpolateHeat (position, true);
+			if (restriction) {
+				int xmin, ymin, xmax, ymax;
+				source.coveredCells (position, 0.5 * this->gridScale, xmin, ymin, xmax, ymax);
+				double sum = 0;
+				int count = 0;
+				for (int sx = xmin; sx < xmax; sx++) {
+					for (int sy = ymin; sy < ymax; sy++) {
+						if (source.isActive (sx, sy)) {
+							sum += source.cellHeat (sx, sy);
+							count++;
+						}
+					}
+				}
+				if (count > 0) {
+					value = sum / count;
+				}
+			}
+			// a sparse grid only allocates the tiles where heat arrived
+			if (fabs (value - this->normalHeat) > WorldHeat::SPARSE_TOLERANCE) {
+				allocateCells (x, y, x + 1, y + 1);
+			}
+			if (!cellAllocated (x, y)) {
+				continue;
+			}
+			this->grid [0][x][y] = this->grid [1][x][y] = value;
+		}
+	}
+	this->wakeUp ();
+}
+
+void WorldHeat::
+coveredCells (const Vector &position, double halfWidth, int &xmin, int &ymin, int &xmax, int &ymax) const
+{
+	// centres in [position-halfWidth,position+halfWidth)
+	xmin = std::max (0, (int) ceil ((position.x - halfWidth - this->origin.x) / this->gridScale));
+	ymin = std::max (0, (int) ceil ((position.y - halfWidth - this->origin.y) / this->gridScale));
+	xmax = std::min ((int) this->size.x, (int) ceil ((position.x + halfWidth - this->origin.x) / this->gridScale));
+	ymax = std::min ((int) this->size.y, (int) ceil ((position.y + halfWidth - this->origin.y) / this->gridScale));
+}
+
+int WorldHeat::
+solveSteadyState (const std::vector<char> &unknown, std::vector<double> &known, const HeatValue *source, double normal)
+{
+	const double loss = this->partialAlpha * this->cellDissipation;
+	const int sizeX = this->size.x;
+	const int sizeY = this->size.y;
+	const int count = sizeX * sizeY;
+	std::vector<double> east (count, 0.0), north (count, 0.0), diagonal (count, 0.0), rhs (count, 0.0);
+	for (int x = 0; x < sizeX; x++) {
+		for (int y = 0; y < sizeY; y++) {
+			const int i = x * sizeY + y;
+			if (!unknown [i]) {
+				continue;
+			}
+			const std::ptrdiff_t index = this->layout.index (x, y);
+			// active cells are never on the border, so they have four neighbours
+			const double g [4] = {
+				this->eastConductance [x - 1][y],
+				this->eastConductance [x][y],
+				this->northConductance [x][y - 1],
+				this->northConductance [x][y]};
+			const int neighbour [4] = {i - sizeY, i + sizeY, i - 1, i + 1};
+			diagonal [i] = loss + g [0] + g [1] + g [2] + g [3];
+			rhs [i] = loss * normal + (source != NULL ? source [index] : 0);
+			for (int j = 0; j < 4; j++) {
+				if (!unknown [neighbour [j]]) {
+					rhs [i] += g [j] * known [neighbour [j]];
+				}
+			}
+			if (unknown [i + sizeY]) {
+				east [i] = g [1];
+			}
+			if (unknown [i + 1]) {
+				north [i] = g [3];
+			}
+		}
+	}
+	HeatMultigrid solver (sizeX, sizeY, unknown, east, north, diagonal);
+	return solver.solve (rhs, known, WorldHeat::EQUILIBRIUM_TOLERANCE, WorldHeat::EQUILIBRIUM_ITERATIONS);
+}
+
+#ifndef WORLDHEAT_SERIAL
+/**
+ * Job that advances the active cells of some tiles one explicit step.
+ * Task {@code i} advances tile {@code tiles[i]}, or tile {@code i} if
+ * there is no list of tiles.
+ */
+class ActiveCellsJob:
+	public WorkerPool::Job
+{
+	WorldHeat *heat;
+	const std::vector<int> *tiles;
+	const HeatValue *source;
+	HeatValue *target;
+	const double normal;
+public:
+	ActiveCellsJob (WorldHeat *heat, const std::vector<int> *tiles, const HeatValue *source, HeatValue *target, double normal):
+		heat (heat),
+		tiles (tiles),
+		source (source),
+		target (target),
+		normal (normal)
+	{
+	}
+
+	virtual void runTask (int task, int worker)
+	{
+		this->heat->updateActiveTile (this->tiles == NULL ? task : (*this->tiles) [task], this->source, this->target, this->normal);
+	}
+};
+#endif
+
+void WorldHeat::
+updateActiveCells (const HeatValue *heat, HeatValue *next, double normal, const std::vector<int> *tiles)
+{
+	const int count = tiles == NULL ? this->tiling.size () : tiles->size ();
+#ifdef WORLDHEAT_SERIAL
+	for (int i = 0; i < count; i++) {
+		updateActiveTile (tiles == NULL ? i : (*tiles) [i], heat, next, normal);
+	}
+#else
+	ActiveCellsJob job (this, tiles, heat, next, normal);
+	this->runJob (&job, count);
+#endif
+}
+
+void WorldHeat::
+updateActiveTile (int tile, const HeatValue *heat, HeatValue *next, double normal)
+{
+	const GridTile &t = this->tiling [tile];
+	const double loss = this->conductanceFactor * this->cellDissipation;
+	GridTile block;
+	int x = t.xmin;
+	while (this->nextActiveBlock (x, t.xmax, t.ymin, t.ymax, block)) {
+		this->kernel (
+			heat,
+			this->eastConductance.data (),
+			this->northConductance.data (),
+			next,
+			this->layout.stride,
+			block.xmin, block.ymin, block.xmax, block.ymax,
+			normal,
+			loss);
+	}
+}
+
+void WorldHeat::
+trySuperposition (double deltaTime)
+{
+	// the responses of a sparse grid would fill it
+	if (this->solver != EXPLICIT || !this->tileState.empty () || !this->logs.empty () || this->fixedStamps.empty () || !validParameters (deltaTime)) {
+		return ;
+	}
+	// every fixed cell must belong to one actuator with a single
+	// temperature, and there must be no heat sources
+	const HeatValue *fixed = this->fixedHeat.data ();
+	size_t fixedCells = 0;
+	for (std::vector<TileBoundary>::const_iterator tile = this->boundary.begin (); tile != this->boundary.end (); tile++) {
+		if (tile->sources) {
+			return ;
+		}
+		fixedCells += tile->cells.size ();
+	}
+	std::vector<double> values (this->fixedStamps.size ());
+	size_t stampCells = 0;
+	size_t a = 0;
+	for (FixedStamps::const_iterator stamp = this->fixedStamps.begin (); stamp != this->fixedStamps.end (); stamp++, a++) {
+		bool first = true;
+		for (std::vector<std::ptrdiff_t>::const_iterator cell = stamp->second.begin (); cell != stamp->second.end (); cell++) {
+			if (!this->isActive (*cell / this->layout.stride, *cell % this->layout.stride)) {
+				continue;
+			}
+			if (std::isnan (fixed [*cell]) || (!first && fixed [*cell] != values [a])) {
+				return ;
+			}
+			values [a] = fixed [*cell];
+			first = false;
+			stampCells++;
+		}
+	}
+	if (stampCells != fixedCells) {
+		return ;
+	}
+	// the grid must be steady, one step is computed in the scratch plane
+	prepareConductances (this->partialAlpha * deltaTime);
+	if (this->scratch.data () == NULL) {
+		this->scratch.resize (this->layout);
+	}
+	const HeatValue *current = this->grid [this->adtIndex].data ();
+	const HeatValue *next = this->scratch.data ();
+	updateActiveCells (current, this->scratch.data (), this->normalHeat, NULL);
+	double maxChange = 0;
+	for (int x = 1; x < this->size.x - 1; x++) {
+		for (int y = this->spans [x].ymin; y < this->spans [x].ymax; y++) {
+			const std::ptrdiff_t index = this->layout.index (x, y);
+			if (std::isnan (fixed [index])) {
+				maxChange = std::max (maxChange, (double) fabs (next [index] - current [index]));
+			}
+		}
+	}
+	if (maxChange > WorldHeat::SUPERPOSITION_STEADY_RATE * deltaTime) {
+		return ;
+	}
+	bool reuse =
+		this->superposition != NULL
+		&& !this->responsesDirty
+		&& this->superpositionDeltaTime == deltaTime
+		&& this->superposition->size () == (int) this->fixedStamps.size ();
+	a = 0;
+	for (FixedStamps::const_iterator stamp = this->fixedStamps.begin (); reuse && stamp != this->fixedStamps.end (); stamp++, a++) {
+		reuse = this->superposition->getOwner (a) == stamp->first && this->superposition->getCells (a) == stamp->second;
+	}
+	if (!reuse) {
+		computeResponses (deltaTime);
+	}
+	this->superposition->start (current, values);
+	this->superposed = true;
+	this->frozen = false;
+	this->frozenWrites.clear ();
+	cout << "Heat superposed at time " << this->relativeTime << "s\n";
+}
+
+void WorldHeat::
+computeResponses (double deltaTime)
+{
+	const int sizeX = this->size.x;
+	const int sizeY = this->size.y;
+	const size_t cells = this->layout.index (sizeX - 1, sizeY - 1) + 1;
+	const HeatValue *fixed = this->fixedHeat.data ();
+	delete this->superposition;
+	this->superposition = new HeatSuperposition (this->layout);
+	cout << "Heat computing the step responses of " << this->fixedStamps.size () << " actuators\n";
+	// steady responses
+	prepareConductances (this->partialAlpha);
+	std::vector<char> unknown (sizeX * sizeY, 0);
+	for (int x = 0; x < sizeX; x++) {
+		for (int y = 0; y < sizeY; y++) {
+			unknown [x * sizeY + y] = this->isActive (x, y) && std::isnan (fixed [this->layout.index (x, y)]);
+		}
+	}
+	for (FixedStamps::const_iterator stamp = this->fixedStamps.begin (); stamp != this->fixedStamps.end (); stamp++) {
+		std::vector<double> known (sizeX * sizeY, 0.0);
+		for (std::vector<std::ptrdiff_t>::const_iterator cell = stamp->second.begin (); cell != stamp->second.end (); cell++) {
+			known [(*cell / this->layout.stride) * sizeY + *cell % this->layout.stride] = 1;
+		}
+		solveSteadyState (unknown, known, NULL, 0);
+		std::vector<double> steady (cells, 0.0);
+		for (int x = 0; x < sizeX; x++) {
+			for (int y = 0; y < sizeY; y++) {
+				steady [this->layout.index (x, y)] = known [x * sizeY + y];
+			}
+		}
+		this->superposition->addActuator (stamp->first, stamp->second, steady);
+	}
+	// sampled step responses, with the explicit update of the tiles that
+	// heat reached, one cell per step from the actuator
+	prepareConductances (this->partialAlpha * deltaTime);
+	const int horizon = WorldHeat::SUPERPOSITION_HORIZON / deltaTime;
+	GridField<HeatValue> planes [2];
+	std::vector<int> tiles;
+	size_t a = 0;
+	for (FixedStamps::const_iterator actuator = this->fixedStamps.begin (); actuator != this->fixedStamps.end (); actuator++, a++) {
+		for (int i = 0; i < 2; i++) {
+			planes [i].resize (this->layout);
+		}
+		GridTile cover = {sizeX, sizeY, 0, 0};
+		for (std::vector<std::ptrdiff_t>::const_iterator cell = actuator->second.begin (); cell != actuator->second.end (); cell++) {
+			const int x = *cell / this->layout.stride;
+			const int y = *cell % this->layout.stride;
+			cover.xmin = std::min (cover.xmin, x);
+			cover.ymin = std::min (cover.ymin, y);
+			cover.xmax = std::max (cover.xmax, x + 1);
+			cover.ymax = std::max (cover.ymax, y + 1);
+		}
+		int current = 0;
+		for (int step = 0, nextSample = 0; ; step++) {
+			const GridTile reach = {
+				std::max (0, cover.xmin - step),
+				std::max (0, cover.ymin - step),
+				std::min (sizeX, cover.xmax + step),
+				std::min (sizeY, cover.ymax + step)
+			};
+			if (step > 0) {
+				tiles.clear ();
+				for (int i = 0; i < this->tiling.size (); i++) {
+					const GridTile &t = this->tiling [i];
+					if (t.xmin < reach.xmax && t.xmax > reach.xmin && t.ymin < reach.ymax && t.ymax > reach.ymin) {
+						tiles.push_back (i);
+					}
+				}
+				updateActiveCells (planes [current].data (), planes [1 - current].data (), 0, &tiles);
+				current = 1 - current;
+			}
+			HeatValue *heat = planes [current].data ();
+			for (FixedStamps::const_iterator stamp = this->fixedStamps.begin (); stamp != this->fixedStamps.end (); stamp++) {
+				for (std::vector<std::ptrdiff_t>::const_iterator cell = stamp->second.begin (); cell != stamp->second.end (); cell++) {
+					if (this->isActive (*cell / this->layout.stride, *cell % this->layout.stride)) {
+						heat [*cell] = stamp == actuator ? 1 : 0;
+					}
+				}
+			}
+			if (step < nextSample) {
+				continue;
+			}
+			this->superposition->addSample (a, step, heat, reach, WorldHeat::SUPERPOSITION_SAMPLE_TOLERANCE);
+			nextSample = step + std::max (1, (int) (step * WorldHeat::SUPERPOSITION_SAMPLE_SPACING));
+			double difference = 0;
+			for (int x = 1; x < sizeX - 1; x++) {
+				for (int y = this->spans [x].ymin; y < this->spans [x].ymax; y++) {
+					const std::ptrdiff_t index = this->layout.index (x, y);
+					difference = std::max (difference, fabs (heat [index] - this->superposition->getSteady (a, index)));
+				}
+			}
+			if (step > 0 && difference < WorldHeat::SUPERPOSITION_TOLERANCE) {
+				break;
+			}
+			if (step >= horizon) {
+				cerr << "Heat step response did not settle in " << WorldHeat::SUPERPOSITION_HORIZON << "s\n";
+				break;
+			}
+		}
+	}
+	this->superpositionDeltaTime = deltaTime;
+	this->responsesDirty = false;
+}
+
+void WorldHeat::
+leaveSuperposition ()
+{
+	if (!this->superposed) {
+		return ;
+	}
+	for (int x = 1; x < this->size.x - 1; x++) {
+		for (int y = this->spans [x].ymin; y < this->spans [x].ymax; y++) {
+			const HeatValue value = cellHeat (x, y);
+			this->grid [0][x][y] = value;
+			this->grid [1][x][y] = value;
+		}
+	}
+	this->superposed = false;
+	this->stepsToSuperpose = WorldHeat::STEADY_STATE_CHECK_PERIOD;
+	for (size_t i = 0; i < this->activity.size (); i++) {
+		this->activity [i].written = true;
+	}
+	cout << "Heat left superposition at time " << this->relativeTime << "s\n";
+}
+
+#ifndef WORLDHEAT_SERIAL
+/**
+ * Job that runs one half step of the ADI solver.  In the first half step
+ * task {@code i} solves the columns of tile column {@code i}, in the second
+ * half step it solves the rows of tile row {@code i}.
+ */
+class AdiHalfStepJob:
+	public WorkerPool::Job
+{
+	WorldHeat *heat;
+	const GridTiling &tiling;
+	const double deltaTime;
+	const bool rows;
+public:
+	AdiHalfStepJob (WorldHeat *heat, const GridTiling &tiling, double deltaTime, bool rows):
+		heat (heat),
+		tiling (tiling),
+		deltaTime (deltaTime),
+		rows (rows)
+	{
+	}
+
+	virtual void runTask (int task, int worker)
+	{
+		if (this->rows) {
+			const GridTile &tile = this->tiling [task];
+			this->heat->solveRows (this->deltaTime, tile.ymin, tile.ymax);
+		}
+		else {
+			const GridTile &tile = this->tiling [task * this->tiling.getRows ()];
+			this->heat->solveColumns (this->deltaTime, tile.xmin, tile.xmax);
+		}
+	}
+};
+#endif
+
+void WorldHeat::
+updateImplicit (double deltaTime)
+{
+	// border columns are not solved but the second half step reads them
+	prepareConductances (0.5 * this->partialAlpha * deltaTime);
+	const int nextAdtIndex = 1 - this->adtIndex;
+	const int lastColumn = this->size.x - 1;
+	std::copy (this->grid [this->adtIndex][0], this->grid [this->adtIndex][0] + (int) this->size.y, this->grid [nextAdtIndex][0]);
+	std::copy (this->grid [this->adtIndex][lastColumn], this->grid [this->adtIndex][lastColumn] + (int) this->size.y, this->grid [nextAdtIndex][lastColumn]);
+#ifdef WORLDHEAT_SERIAL
+	solveColumns (deltaTime, 1, this->size.x - 1);
+	solveRows (deltaTime, 1, this->size.y - 1);
+#else
+	AdiHalfStepJob columns (this, this->tiling, deltaTime, false);
+	this->runJob (&columns, this->tiling.getColumns ());
+	AdiHalfStepJob rows (this, this->tiling, deltaTime, true);
+	this->runJob (&rows, this->tiling.getRows ());
+#endif
+	// fixed cells are boundary conditions of the line solves, sources are
+	// added after the step
+	applyBoundary (deltaTime, this->grid [this->adtIndex].data (), this->layout.stride, 0, 0, 1, 1, this->size.x - 1, this->size.y - 1);
+}
+
+void WorldHeat::
+solveColumns (double deltaTime, int xmin, int xmax)
+{
+	HeatAdi::solveColumns (
+		this->grid [this->adtIndex].data (),
+		this->eastConductance.data (),
+		this->northConductance.data (),
+		this->fixedHeat.data (),
+		this->grid [1 - this->adtIndex].data (),
+		this->scratch.data (),
+		&this->spans [0],
+		this->layout.stride,
+		this->size.y, xmin, xmax,
+		this->normalHeat,
+		0.5 * this->conductanceFactor * this->cellDissipation);
+}
+
+void WorldHeat::
+solveRows (double deltaTime, int ymin, int ymax)
+{
+	HeatAdi::solveRows (
+		this->grid [1 - this->adtIndex].data (),
+		this->eastConductance.data (),
+		this->northConductance.data (),
+		this->fixedHeat.data (),
+		this->grid [this->adtIndex].data (),
+		this->scratch.data (),
+		&this->spans [0],
+		this->layout.stride,
+		this->size.x, ymin, ymax,
+		this->normalHeat,
+		0.5 * this->conductanceFactor * this->cellDissipation);
+}
+
+void WorldHeat::
+updateSpectral (double deltaTime)
+{
+	// the conductances of the ADI solver, so that falling back does not
+	// recompute them
+	prepareConductances (0.5 * this->partialAlpha * deltaTime);
+	bool rectangular = true;
+	for (int x = 1; x < this->size.x - 1 && rectangular; x++) {
+		rectangular = this->spans [x].ymin == 1 && this->spans [x].ymax == this->size.y - 1;
+	}
+	bool uniform = !this->tileConductance.empty () && this->tileConductance [0] >= 0;
+	for (size_t i = 1; i < this->tileConductance.size () && uniform; i++) {
+		uniform = this->tileConductance [i] == this->tileConductance [0];
+	}
+	// the sine modes have no interior boundary conditions
+	bool unbounded = true;
+	for (size_t i = 0; i < this->boundary.size () && unbounded; i++) {
+		unbounded = this->boundary [i].cells.empty ();
+	}
+	if (!rectangular || !uniform || !unbounded) {
+		if (!this->spectralFallbackReported) {
+			cerr << "Heat grid is not a uniform rectangle without fixed or source cells, using ADI solver\n";
+			this->spectralFallbackReported = true;
+		}
+		updateImplicit (deltaTime);
+		return ;
+	}
+	if (this->spectral == NULL) {
+		this->spectral = new HeatSpectral (this->size.x - 2, this->size.y - 2);
+	}
+	HeatValue *heat = this->grid [this->adtIndex].data ();
+	this->spectral->advance (
+		heat, heat, this->layout.stride,
+		this->partialAlpha * this->tileConductance [0] / this->conductanceFactor,
+		this->partialAlpha * this->cellDissipation,
+		this->normalHeat,
+		deltaTime);
+}
+
+#ifndef WORLDHEAT_SERIAL
+/**
+ * Job that advances the coarse or the fine tiles of a multi-rate update.
+ * Task {@code i} advances tile {@code tiles[i]}.
+ */
+class MultirateJob:
+	public WorkerPool::Job
+{
+	WorldHeat *heat;
+	const std::vector<int> &tiles;
+	const bool coarse;
+public:
+	MultirateJob (WorldHeat *heat, const std::vector<int> &tiles, bool coarse):
+		heat (heat),
+		tiles (tiles),
+		coarse (coarse)
+	{
+	}
+
+	virtual void runTask (int task, int worker)
+	{
+		this->heat->updateMultirateTile (this->tiles [task], this->coarse);
+	}
+};
+#endif
+
+void WorldHeat::
+updateMultirate (double deltaTime)
+{
+	if (this->multirateDirty) {
+		classifyMultirate ();
+	}
+	const int ratio = this->localTimeStepRatio;
+	HeatValue *current = this->grid [this->adtIndex].data ();
+	HeatValue *next = this->grid [1 - this->adtIndex].data ();
+	for (std::vector<InterfaceFace>::iterator face = this->interfaceFaces.begin (); face != this->interfaceFaces.end (); face++) {
+		face->coarseStart = current [face->coarse];
+		face->fineStart = current [face->fine];
+		face->flux = 0;
+	}
+	for (size_t i = 0; i < this->ringCells.size (); i++) {
+		this->ringStart [i] = current [this->ringCells [i]];
+	}
+	// coarse tiles advance the whole time step from the start temperatures
+	this->multirateSource = current;
+	this->multirateTarget = next;
+	this->multirateDeltaTime = ratio * deltaTime;
+	runMultirate (this->coarseTiles, true);
+	for (size_t i = 0; i < this->ringCells.size (); i++) {
+		this->ringEnd [i] = next [this->ringCells [i]];
+	}
+	// fine tiles advance every substep, reading coarse neighbours
+	// interpolated in time
+	this->multirateDeltaTime = deltaTime;
+	for (int s = 0; s < ratio; s++) {
+		HeatValue *source = s % 2 == 0 ? current : next;
+		HeatValue *target = s % 2 == 0 ? next : current;
+		for (size_t i = 0; i < this->ringCells.size (); i++) {
+			source [this->ringCells [i]] = this->ringStart [i] + (this->ringEnd [i] - this->ringStart [i]) * s / ratio;
+		}
+		for (std::vector<InterfaceFace>::iterator face = this->interfaceFaces.begin (); face != this->interfaceFaces.end (); face++) {
+			face->flux += face->conductance * (source [face->coarse] - source [face->fine]);
+		}
+		this->multirateSource = source;
+		this->multirateTarget = target;
+		runMultirate (this->fineTiles, false);
+	}
+	// the result is in the plane written by the last substep
+	HeatValue *result = ratio % 2 == 0 ? current : next;
+	if (result == current) {
+		for (std::vector<int>::const_iterator tile = this->coarseTiles.begin (); tile != this->coarseTiles.end (); tile++) {
+			const GridTile &t = this->tiling [*tile];
+			for (int x = t.xmin; x < t.xmax; x++) {
+				const std::ptrdiff_t column = this->layout.index (x, 0);
+				std::copy (next + column + t.ymin, next + column + t.ymax, current + column + t.ymin);
+			}
+		}
+	}
+	for (size_t i = 0; i < this->ringCells.size (); i++) {
+		result [this->ringCells [i]] = this->ringEnd [i];
+	}
+	// replace the heat that coarse cells exchanged with their fine
+	// neighbours by the heat that fine cells actually exchanged
+	for (std::vector<InterfaceFace>::const_iterator face = this->interfaceFaces.begin (); face != this->interfaceFaces.end (); face++) {
+		result [face->coarse] +=
+			- face->flux
+			- ratio * face->conductance * (face->fineStart - face->coarseStart);
+	}
+	if (result == next) {
+		this->adtIndex = 1 - this->adtIndex;
+	}
+}
+
+void WorldHeat::
+runMultirate (const std::vector<int> &tiles, bool coarse)
+{
+#ifdef WORLDHEAT_SERIAL
+	for (size_t i = 0; i < tiles.size (); i++) {
+		updateMultirateTile (tiles [i], coarse);
+	}
+#else
+	MultirateJob job (this, tiles, coarse);
+	this->runJob (&job, tiles.size ());
+#endif
+}
+
+void WorldHeat::
+updateMultirateTile (int tile, bool coarse)
+{
+	const GridTile &t = this->tiling [tile];
+	const double loss = this->conductanceFactor * this->cellDissipation;
+	GridTile block;
+	int x = t.xmin;
+	while (this->nextActiveBlock (x, t.xmax, t.ymin, t.ymax, block)) {
+		if (coarse) {
+			const int ratio = this->localTimeStepRatio;
+			this->uniformKernel (
+				this->multirateSource,
+				ratio * this->tileConductance [tile],
+				this->multirateTarget,
+				this->layout.stride,
+				block.xmin, block.ymin, block.xmax, block.ymax,
+				this->normalHeat,
+				ratio * loss);
+		}
+		else {
+			this->kernel (
+				this->multirateSource,
+				this->eastConductance.data (),
+				this->northConductance.data (),
+				this->multirateTarget,
+				this->layout.stride,
+				block.xmin, block.ymin, block.xmax, block.ymax,
+				this->normalHeat,
+				loss);
+		}
+	}
+	if (!coarse) {
+		applyBoundary (this->multirateDeltaTime, this->multirateTarget, this->layout.stride, 0, 0, t.xmin, t.ymin, t.xmax, t.ymax);
+	}
+}
+
+void WorldHeat::
+classifyMultirate ()
+{
+	const int ratio = this->localTimeStepRatio;
+	const double loss = this->conductanceFactor * this->cellDissipation;
+	std::vector<bool> coarse (this->tiling.size (), false);
+	this->coarseTiles.clear ();
+	this->fineTiles.clear ();
+	const int candidates = this->activeTiles.empty () ? this->tiling.size () : this->activeTiles.size ();
+	for (int k = 0; k < candidates; k++) {
+		const int i = this->activeTiles.empty () ? k : this->activeTiles [k];
+		// a coarse cell must keep a non negative weight of its own temperature
+		coarse [i] =
+			this->tileConductance [i] >= 0
+			&& ratio * (4 * this->tileConductance [i] + loss) <= 1
+			&& (this->boundary.empty () || this->boundary [i].cells.empty ());
+		(coarse [i] ? this->coarseTiles : this->fineTiles).push_back (i);
+	}
+	this->interfaceFaces.clear ();
+	this->ringCells.clear ();
+	for (std::vector<int>::const_iterator tile = this->coarseTiles.begin (); tile != this->coarseTiles.end (); tile++) {
+		const GridTile &t = this->tiling [*tile];
+		for (int x = t.xmin; x < t.xmax; x++) {
+			for (int y = t.ymin; y < t.ymax; y++) {
+				if (!this->isActive (x, y)) {
+					continue;
+				}
+				const int nx [4] = {x - 1, x + 1, x, x};
+				const int ny [4] = {y, y, y - 1, y + 1};
+				bool ring = false;
+				for (int j = 0; j < 4; j++) {
+					if (!this->isActive (nx [j], ny [j]) || coarse [this->tiling.tileAt (nx [j], ny [j])]) {
+						continue;
+					}
+					InterfaceFace face;
+					face.coarse = this->layout.index (x, y);
+					face.fine = this->layout.index (nx [j], ny [j]);
+					// cell (x,y) of the east and north planes is the face after it
+					face.conductance =
+						j == 0 ? this->eastConductance [x - 1][y]
+						: j == 1 ? this->eastConductance [x][y]
+						: j == 2 ? this->northConductance [x][y - 1]
+						: this->northConductance [x][y];
+					this->interfaceFaces.push_back (face);
+					ring = true;
+				}
+				if (ring) {
+					this->ringCells.push_back (this->layout.index (x, y));
+				}
+			}
+		}
+	}
+	this->ringStart.resize (this->ringCells.size ());
+	this->ringEnd.resize (this->ringCells.size ());
+	this->multirateDirty = false;
+}
+
+void WorldHeat::
+prepareConductances (double factor)
+{
+	if (!this->conductancesDirty && factor == this->conductanceFactor) {
+		return ;
+	}
+	this->conductanceFactor = factor;
+	if (this->tileState.empty ()) {
+		computeConductances (0, 0, this->size.x, this->size.y);
+	}
+	else {
+		// faces between allocated tiles are computed by the west or south one
+		for (int i = 0; i < this->tiling.size (); i++) {
+			if (this->tileState [i] != UNALLOCATED_TILE) {
+				int xmin, ymin, xmax, ymax;
+				tileCells (i, xmin, ymin, xmax, ymax);
+				computeConductances (xmin, ymin, xmax, ymax);
+			}
+		}
+	}
+	this->responsesDirty = this->responsesDirty || this->conductancesDirty;
+	this->conductancesDirty = false;
+	classifyTiles ();
+}
+
+void WorldHeat::
+computeConductances (int xmin, int ymin, int xmax, int ymax)
+{
+	const HeatDiffusivity *d = this->prop.data ();
+	const HeatValue *classes = this->getDiffusivityClasses ();
+	const std::ptrdiff_t stride = this->layout.stride;
+	const double factor = this->conductanceFactor;
+	const int sizeX = this->size.x;
+	const int sizeY = this->size.y;
+	for (int x = xmin; x < xmax; x++) {
+		HeatValue *e = this->eastConductance [x];
+		HeatValue *n = this->northConductance [x];
+		for (int y = ymin; y < ymax; y++) {
+			const std::ptrdiff_t i = this->layout.index (x, y);
+			const double here = HeatKernels::diffusivityAt (d, i, classes);
+			// faces that leave the grid are never used
+			e [y] = x + 1 < sizeX
+				? factor * HeatKernels::faceConductance (here, HeatKernels::diffusivityAt (d, i + stride, classes))
+				: 0;
+			n [y] = y + 1 < sizeY
+				? factor * HeatKernels::faceConductance (here, HeatKernels::diffusivityAt (d, i + 1, classes))
+				: 0;
+		}
+	}
+}
+
+void WorldHeat::
+computeTileConductances (int tile)
+{
+	const int rows = this->tiling.getRows ();
+	const int columns = this->tiling.getColumns ();
+	const int column = tile / rows;
+	const int row = tile % rows;
+	int xmin, ymin, xmax, ymax;
+	tileCells (tile, xmin, ymin, xmax, ymax);
+	computeConductances (xmin, ymin, xmax, ymax);
+	// the faces with an allocated west or south neighbour read this tile
+	if (column > 0 && this->tileState [tile - rows] != UNALLOCATED_TILE) {
+		computeConductances (xmin - 1, ymin, xmin, ymax);
+	}
+	if (row > 0 && this->tileState [tile - 1] != UNALLOCATED_TILE) {
+		computeConductances (xmin, ymin - 1, xmax, ymin);
+	}
+	const int neighbours [5] = {
+		tile,
+		column > 0 ? tile - rows : -1,
+		column < columns - 1 ? tile + rows : -1,
+		row > 0 ? tile - 1 : -1,
+		row < rows - 1 ? tile + 1 : -1};
+	for (int i = 0; i < 5; i++) {
+		if (neighbours [i] >= 0 && this->tileState [neighbours [i]] != UNALLOCATED_TILE) {
+			this->tileConductance [neighbours [i]] = classifyTile (neighbours [i]);
+		}
+	}
+}
+
+void WorldHeat::
+classifyTiles ()
+{
+	this->tileConductance.resize (this->tiling.size ());
+	for (int i = 0; i < this->tiling.size (); i++) {
+		const bool stored = this->tileState.empty () || this->tileState [i] != UNALLOCATED_TILE;
+		this->tileConductance [i] = stored ? classifyTile (i) : -1;
+	}
+	this->multirateDirty = true;
+}
+
+HeatValue WorldHeat::
+classifyTile (int tile) const
+{
+	const GridTile &t = this->tiling [tile];
+	const HeatValue k = this->eastConductance [t.xmin][t.ymin];
+	// a tile reads the faces of its cells and the west and south faces
+	// of its first column and row
+	for (int x = t.xmin - 1; x < t.xmax; x++) {
+		const HeatValue *e = this->eastConductance [x];
+		const HeatValue *n = this->northConductance [x];
+		for (int y = t.ymin; y < t.ymax; y++) {
+			if (e [y] != k || (x >= t.xmin && n [y - 1] != k)) {
+				return -1;
+			}
+		}
+		if (x >= t.xmin && n [t.ymax - 1] != k) {
+			return -1;
+		}
+	}
+	return k;
+}
+
+HeatDiffusivity WorldHeat::
+toDiffusivity (double value)
+{
+#ifdef WORLDHEAT_DIFFUSIVITY_CLASSES
+	const HeatValue diffusivity = value;
+	int closest = 0;
+	for (int i = 0; i < this->numberClasses; i++) {
+		if (this->diffusivityClasses [i] == diffusivity) {
+			return i;
+		}
+		if (fabs (this->diffusivityClasses [i] - diffusivity) < fabs (this->diffusivityClasses [closest] - diffusivity)) {
+			closest = i;
+		}
+	}
+	if (this->numberClasses < HeatKernels::MAXIMUM_CLASSES) {
+		this->diffusivityClasses [this->numberClasses] = diffusivity;
+		return this->numberClasses++;
+	}
+	cerr << "Too many heat diffusivities, using " << this->diffusivityClasses [closest] << " instead of " << value << '\n';
+	return closest;
+#else
+	return value;
+#endif
+}
+
+WorldHeat::Solver WorldHeat::
+selectSolver (const std::string &name)
+{
+	if (name == "adi") {
+		return ADI;
+	}
+	if (name == "spectral") {
+		return SPECTRAL;
+	}
+	if (name != "explicit") {
+		cerr << "Unknown heat solver " << name << ", using explicit solver\n";
+	}
+	return EXPLICIT;
+}
+
+bool WorldHeat::
+saveState (std::string filename) const
+{
+	HeatStateHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, HEAT_STATE_MAGIC, sizeof (HEAT_STATE_MAGIC));
+	header.version = HEAT_STATE_VERSION;
+	header.headerSize = sizeof (HeatStateHeader);
+	header.borderSize = this->borderSize;
+	header.gridScale = this->gridScale;
+	header.sizeX = this->size.x;
+	header.sizeY = this->size.y;
+	header.originX = this->origin.x;
+	header.originY = this->origin.y;
+	header.normalHeat = this->normalHeat;
+	ofstream ofs (filename.c_str (), std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+	ofs.write (reinterpret_cast<const char *> (&header), sizeof (header));
+	// planes are written a column at a time, converted to double
+	std::vector<double> column (header.sizeY);
+	for (int x = 0; x < header.sizeX; x++) {
+		for (int y = 0; y < header.sizeY; y++) {
+			column [y] = cellHeat (x, y);
+		}
+		ofs.write (reinterpret_cast<const char *> (&column [0]), column.size () * sizeof (double));
+	}
+	for (int x = 0; x < header.sizeX; x++) {
+		for (int y = 0; y < header.sizeY; y++) {
+			column [y] = cellDiffusivity (x, y);
+		}
+		ofs.write (reinterpret_cast<const char *> (&column [0]), column.size () * sizeof (double));
+	}
+	ofs.close ();
+	return !ofs.fail ();
+}
+
+void WorldHeat::
+logToStream (std::string fileName)
+{
+	// the log thread reads the whole grid
+	allocateAllTiles ();
+	std::vector<std::pair<int, int> > cells;
+	for (int y = 1; y < this->size.y - 1; y++) {
+		for (int x = 1; x < this->size.x - 1; x++) {
+			cells.push_back (std::make_pair (x, y));
+		}
+	}
+	this->startLog (fileName, cells, this->size.x - 2, this->logRate + 1, this->iterationsToNextLog);
+}
+
+void WorldHeat::
+logRectangle (const std::string &fileName, int period, int step, const Point &min, const Point &max)
+{
+	int xmin, ymin, xmax, ymax;
+	toIndex (min, xmin, ymin);
+	toIndex (max, xmax, ymax);
+	xmin = std::max (xmin, 1);
+	ymin = std::max (ymin, 1);
+	xmax = std::min (xmax, (int) this->size.x - 2);
+	ymax = std::min (ymax, (int) this->size.y - 2);
+	step = std::max (step, 1);
+	std::vector<std::pair<int, int> > cells;
+	for (int y = ymin; y <= ymax; y += step) {
+		for (int x = xmin; x <= xmax; x += step) {
+			cells.push_back (std::make_pair (x, y));
+		}
+	}
+	const int columns = xmax >= xmin ? (xmax - xmin) / step + 1 : 0;
+	this->startLog (fileName, cells, columns, period, 0);
+}
+
+void WorldHeat::
+logDisc (const std::string &fileName, int period, int step, const Point &centre, double radius)
+{
+	int cx, cy;
+	toIndex (centre, cx, cy);
+	const int r = this->scale (radius);
+	step = std::max (step, 1);
+	std::vector<std::pair<int, int> > cells;
+	for (int y = cy - r; y <= cy + r; y += step) {
+		for (int x = cx - r; x <= cx + r; x += step) {
+			if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r
+				 && x >= 1 && x < this->size.x - 1 && y >= 1 && y < this->size.y - 1) {
+				cells.push_back (std::make_pair (x, y));
+			}
+		}
+	}
+	this->startLog (fileName, cells, cells.size (), period, 0);
+}
+
+void WorldHeat::
+logProbes (const std::string &fileName, int period, const std::vector<Point> &probes)
+{
+	std::vector<std::pair<int, int> > cells;
+	for (std::vector<Point>::const_iterator probe = probes.begin (); probe != probes.end (); probe++) {
+		int x, y;
+		toIndex (*probe, x, y);
+		if (!this->layout.contains (x, y)) {
+			cerr << "Heat probe " << *probe << " is outside the grid, ignored\n";
+			continue;
+		}
+		cells.push_back (std::make_pair (x, y));
+	}
+	this->startLog (fileName, cells, cells.size (), period, 0);
+}
+
+bool WorldHeat::
+addLogRegion (const std::string &description)
+{
+	istringstream iss (description);
+	string type, fileName;
+	int period, step = 1;
+	iss >> type >> fileName >> period;
+	if (type == "rectangle") {
+		Point min, max;
+		iss >> step >> min.x >> min.y >> max.x >> max.y;
+		if (!iss.fail () && period > 0) {
+			this->logRectangle (fileName, period, step, min, max);
+			return true;
+		}
+	}
+	else if (type == "disc") {
+		Point centre;
+		double radius;
+		iss >> step >> centre.x >> centre.y >> radius;
+		if (!iss.fail () && period > 0) {
+			this->logDisc (fileName, period, step, centre, radius);
+			return true;
+		}
+	}
+	else if (type == "probes") {
+		std::vector<Point> probes;
+		Point probe;
+		while (iss >> probe.x >> probe.y) {
+			probes.push_back (probe);
+		}
+		if (!probes.empty () && period > 0) {
+			this->logProbes (fileName, period, probes);
+			return true;
+		}
+	}
+	cerr << "Invalid heat log region: " << description << '\n';
+	return false;
+}
+
+void WorldHeat::
+turnOffLog ()
+{
+	for (std::vector<LogRegion>::iterator region = this->logs.begin (); region != this->logs.end (); region++) {
+		delete region->log;
+	}
+	this->logs.clear ();
+}
+
+void WorldHeat::
+startLog (const std::string &fileName, const std::vector<std::pair<int, int> > &cells, int columns, int period, int countdown)
+{
+	// logs read the grid
+	leaveSuperposition ();
+	std::vector<std::ptrdiff_t> offsets;
+	offsets.reserve (cells.size ());
+	ofstream ofs ((fileName + ".cells").c_str (), std::ofstream::out | std::ofstream::trunc);
+	for (std::vector<std::pair<int, int> >::const_iterator cell = cells.begin (); cell != cells.end (); cell++) {
+		// the log thread reads the logged cells of a sparse grid
+		if (!this->tileState.empty ()) {
+			allocateTile (this->tiling.tileAt (cell->first, cell->second));
+		}
+		offsets.push_back (this->layout.index (cell->first, cell->second));
+		ofs
+			<< this->origin.x + cell->first * this->gridScale << ' '
+			<< this->origin.y + cell->second * this->gridScale << '\n';
+	}
+	ofs.close ();
+	LogRegion region;
+	region.log = new HeatLog (fileName, offsets, columns);
+	region.period = std::max (period, 1);
+	region.countdown = countdown;
+	this->logs.push_back (region);
+}
+
+void WorldHeat::
+resetTemperature (double value)
+{
+	this->wakeUp ();
+	if (fabs (value - this->normalHeat) > WorldHeat::SPARSE_TOLERANCE) {
+		allocateAllTiles ();
+	}
+	// border and inactive cells are never updated, so both planes need them
+	std::vector<GridTile> regions;
+	storedRegions (regions);
+	for (std::vector<GridTile>::const_iterator r = regions.begin (); r != regions.end (); r++) {
+		for (int i = 0; i < 2; i++) {
+			for (int x = r->xmin; x < r->xmax; x++) {
+				std::fill (this->grid [i][x] + r->ymin, this->grid [i][x] + r->ymax, HeatValue (value));
+			}
 		}
 	}
 }
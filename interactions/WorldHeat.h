@@ -1,7 +1,10 @@
 #ifndef __WORLD_HEAT_H
 #define __WORLD_HEAT_H
 
+#include <cmath>
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -10,6 +13,11 @@
 #include "extensions/PhysicSimulation.h"
 #include "interactions/AbstractGridParallelSimulation.h"
 #include "interactions/AbstractGridProperties.h"
+#include "interactions/HeatKernels.h"
+#include "interactions/HeatAdi.h"
+#include "interactions/HeatLog.h"
+#include "interactions/HeatSuperposition.h"
+#include "interactions/HeatSpectral.h"
 
 namespace Enki
 {
@@ -23,18 +31,28 @@ namespace Enki
 	 * also implement heat dissipation, meaning the temperature will tend to
 	 * world temperature.
 
+	 * <p> Heat flows between two neighbours through a face whose
+	 * conductance is the harmonic mean of their diffusivities.  Face
+	 * conductances are computed from the diffusivity plane when it changes,
+	 * so the update of the grid does not read the diffusivity plane.
+
 	 * <p> We use two grids.  A {@code AbstractGridSimulation} instance is
 	 * used to computed the temperature in the next iteration.  An {@code
 	 * AbstractGridProperties} instance is used to store grid properties,
 	 * namely heat diffusivity.
+
+	 * <p> The cell types are {@code HeatValue} and {@code HeatDiffusivity},
+	 * see macros {@code WORLDHEAT_FLOAT} and {@code
+	 * WORLDHEAT_DIFFUSIVITY_CLASSES}.  The public methods take and return
+	 * doubles whatever the cell types.
 	 */
 	class WorldHeat :
 #ifdef WORLDHEAT_SERIAL
-		public AbstractGridSimulation<double>,
+		public AbstractGridSimulation<HeatValue>,
 #else
-		public AbstractGridParallelSimulation<WorldHeat, double>,
+		public AbstractGridParallelSimulation<WorldHeat, HeatValue>,
 #endif
-		public AbstractGridProperties<double>
+		public AbstractGridProperties<HeatDiffusivity>
 	{
 		/**
 		 * Value of alpha without the value of parameter {@code deltaTime}.  Alpha
@@ -43,9 +61,31 @@ namespace Enki
 		 */
 		const double partialAlpha;
 		/**
-		 * Output stream where heat information is logged.
+		 * Cell dissipation of this grid, {@code CELL_DISSIPATION} except on
+		 * the coarse grid of a warm-up, where it is scaled so that cells
+		 * lose heat at the same rate per second as on the fine grid.
+		 */
+		double cellDissipation;
+		/**
+		 * A heat log and how often it is written.
+		 */
+		struct LogRegion
+		{
+			HeatLog *log;
+			/**
+			 * Number of calls of method {@code computeNextState(double)}
+			 * between two frames.
+			 */
+			int period;
+			/**
+			 * Calls left before the next frame.
+			 */
+			int countdown;
+		};
+		/**
+		 * Logs of the whole grid, of regions and of probe lists.
 		 */
-		std::ofstream *logStream;
+		std::vector<LogRegion> logs;
 		/**
 		 * Rate at which world heat is logged.  This is used with field
 		 * {@code iterationsToNextLog} to produce logs.
@@ -68,6 +108,344 @@ namespace Enki
 		 * simulation time.
 		 */
 		double relativeTime;
+		/**
+		 * Function that updates blocks of the grid.
+		 */
+		const HeatKernels::Function kernel;
+		/**
+		 * Function that updates blocks where every face has the same
+		 * conductance, for the same instruction set as field {@code kernel}.
+		 */
+		const HeatKernels::UniformFunction uniformKernel;
+		/**
+		 * How many calls of method {@code computeNextState(double)} are
+		 * grouped in a single temporally blocked update of the grid.
+		 */
+		int temporalBlocking;
+		/**
+		 * How many calls of method {@code computeNextState(double)} have not
+		 * yet been applied to the grid.
+		 */
+		int pendingSubsteps;
+	public:
+		/**
+		 * Time integration methods.
+		 */
+		enum Solver {
+			/**
+			 * Forward Euler with the heat kernels.  It is stable only if
+			 * method {@code validParameters(double)} returns true.
+			 */
+			EXPLICIT,
+			/**
+			 * Peaceman-Rachford alternating direction implicit method, see
+			 * class {@code HeatAdi}.  It is stable for any time step.
+			 */
+			ADI,
+			/**
+			 * Exact exponential decay of the sine modes of the grid, see
+			 * class {@code HeatSpectral}.  It is stable for any time step and
+			 * needs a rectangular grid of uniform diffusivity without fixed
+			 * or source cells.  Other grids are advanced by the ADI solver.
+			 */
+			SPECTRAL
+		};
+	private:
+		/**
+		 * Time integration method of this instance.
+		 */
+		const Solver solver;
+		/**
+		 * Modified upper diagonals of the implicit solver, or the step
+		 * that probes whether the explicit solver can start superposition.
+		 * Allocated by the ADI and spectral solvers, and by the explicit
+		 * solver at its first superposition attempt.
+		 */
+		GridField<HeatValue> scratch;
+		/**
+		 * Conductances of the faces between each cell and its neighbour
+		 * along x and along y, see class {@code HeatKernels}.  They are
+		 * harmonic means of the diffusivities of the two cells multiplied
+		 * by field {@code conductanceFactor}.
+		 */
+		GridField<HeatValue> eastConductance;
+		GridField<HeatValue> northConductance;
+		/**
+		 * Factor of the discrete equation included in the conductances.
+		 */
+		double conductanceFactor;
+		/**
+		 * Whether the diffusivity plane changed since the conductances were
+		 * computed.
+		 */
+		bool conductancesDirty;
+		/**
+		 * Conductance of every face read by the update of each tile of
+		 * field {@code tiling}, or -1 if the tile reads faces with different
+		 * conductances.  Uniform tiles are updated by the uniform kernel.
+		 */
+		std::vector<HeatValue> tileConductance;
+		/**
+		 * Whether the grid has reached steady state and is no longer
+		 * updated.
+		 */
+		bool frozen;
+		/**
+		 * Temperature when the current steady state check period started.
+		 * Only allocated if steady state detection is enabled.  In a sparse
+		 * grid it only holds the allocated tiles.
+		 */
+		GridField<HeatValue> snapshot;
+		/**
+		 * Whether field {@code snapshot} holds the start of the current
+		 * check period.
+		 */
+		bool snapshotTaken;
+		/**
+		 * Number of calls of method {@code computeNextState(double)} until
+		 * the end of the current check period.
+		 */
+		int stepsToCheck;
+		/**
+		 * Simulation time since field {@code snapshot} was taken.
+		 */
+		double timeSinceSnapshot;
+		/**
+		 * Heat written by actuators in the first step of frozen mode,
+		 * indexed by linear cell index.  Later writes are compared with
+		 * these values.
+		 */
+		std::map<std::ptrdiff_t, double> frozenWrites;
+		/**
+		 * Whether field {@code frozenWrites} is complete.
+		 */
+		bool frozenWritesRecorded;
+		/**
+		 * Whether the next update replaces the temperature by the steady
+		 * state, see method {@code equilibrate()}.
+		 */
+		bool equilibriumRequested;
+		/**
+		 * Simulation time of the warm-up run at the start of the next
+		 * update, zero if none.  See method {@code warmUp(double)}.
+		 */
+		double warmUpDuration;
+		/**
+		 * Step responses of the actuators, NULL until they are first
+		 * computed.  See field {@code SUPERPOSITION}.
+		 */
+		HeatSuperposition *superposition;
+		/**
+		 * Whether the temperature is given by field {@code superposition}
+		 * instead of the grid, which is not updated.
+		 */
+		bool superposed;
+		/**
+		 * Whether the diffusivity changed since the responses were
+		 * computed.
+		 */
+		bool responsesDirty;
+		/**
+		 * Spectral solver of the grid, NULL until the first spectral
+		 * update.
+		 */
+		HeatSpectral *spectral;
+		/**
+		 * Whether the spectral solver has reported that it falls back to
+		 * the ADI solver.
+		 */
+		bool spectralFallbackReported;
+		/**
+		 * Time step of the responses.
+		 */
+		double superpositionDeltaTime;
+		/**
+		 * Number of updates until the next attempt to superpose.
+		 */
+		int stepsToSuperpose;
+		/**
+		 * Cells given to method {@code setFixedHeat} by each actuator,
+		 * until they are cleared, by owner.
+		 */
+		typedef std::map<const void *, std::vector<std::ptrdiff_t> > FixedStamps;
+		FixedStamps fixedStamps;
+		/**
+		 * Positions of the samples requested by sensors in the current call
+		 * of method {@code computeNextState(double)}.
+		 */
+		std::vector<Vector> requestedPositions;
+		/**
+		 * Positions and temperatures of the samples gathered at the end of
+		 * the previous call.
+		 */
+		std::vector<Vector> sampledPositions;
+		std::vector<double> sampledHeat;
+		/**
+		 * Number of gatherings of requested samples.
+		 */
+		int sampleRound;
+		/**
+		 * Activity of a tile of the grid, used to skip tiles where the
+		 * temperature is not changing.
+		 */
+		struct TileActivity
+		{
+			/**
+			 * Largest temperature change in the last update of the tile.
+			 */
+			double maxDelta;
+			/**
+			 * Whether the temperature of a cell of the tile was written or
+			 * reset since the last update.
+			 */
+			bool written;
+			/**
+			 * Whether the tile was skipped in the last update.  Both grids
+			 * hold the same values in a skipped tile.
+			 */
+			bool skipped;
+			/**
+			 * Whether the tile is updated in the current update.
+			 */
+			bool update;
+		};
+		/**
+		 * Activity of each tile of field {@code tiling}.
+		 */
+		std::vector<TileActivity> activity;
+		/**
+		 * Tiles given to the worker threads in the current update.
+		 */
+		std::vector<int> updatedTiles;
+		/**
+		 * Tiles of field {@code tiling} that have active cells, see field
+		 * {@code AbstractGrid::spans}.  Empty if every tile has active
+		 * cells.  Other tiles are never updated.
+		 */
+		std::vector<int> activeTiles;
+		/**
+		 * Storage state of a tile of a sparse grid, see field {@code
+		 * SPARSE_TOLERANCE}.
+		 */
+		enum TileState {
+			/**
+			 * The cells are not stored and have the environmental
+			 * temperature and the diffusivity of air.
+			 */
+			UNALLOCATED_TILE,
+			/**
+			 * The cells are stored but not updated.  Both grids hold the same
+			 * values.
+			 */
+			ALLOCATED_TILE,
+			/**
+			 * The cells are stored and updated.  The eight neighbours of the
+			 * tile are allocated.
+			 */
+			LIVE_TILE
+		};
+		/**
+		 * State of each tile of field {@code tiling}.  Empty if the grid is
+		 * dense.
+		 */
+		std::vector<char> tileState;
+		/**
+		 * Live tiles of a sparse grid that have active cells, in the order
+		 * they became live.  They are the tiles updated by the explicit
+		 * solver.
+		 */
+		std::vector<int> liveTiles;
+		/**
+		 * Temperature imposed on cells by actuators, a Dirichlet boundary
+		 * condition.  Free cells hold NaN.  Allocated when the first cell
+		 * is fixed.
+		 */
+		GridField<HeatValue> fixedHeat;
+		/**
+		 * Heat source of each cell, in degrees per second.  Allocated when
+		 * the first source is set.
+		 */
+		GridField<HeatValue> heatSource;
+		/**
+		 * Cells of a tile with a fixed temperature or a heat source.
+		 */
+		struct TileBoundary
+		{
+			std::vector<std::ptrdiff_t> cells;
+			/**
+			 * Whether any of the cells has a heat source.  Tiles with
+			 * sources are never skipped.
+			 */
+			bool sources;
+		};
+		/**
+		 * Fixed and source cells of each tile of field {@code tiling}.
+		 * Empty if no cell was ever fixed or given a source.
+		 */
+		std::vector<TileBoundary> boundary;
+		/**
+		 * Number of substeps of a multi-rate update, one if multi-rate
+		 * updates are disabled.  See field {@code LOCAL_TIME_STEP_RATIO}.
+		 */
+		int localTimeStepRatio;
+		/**
+		 * Tiles that advance once per multi-rate update with the whole
+		 * time step, and tiles that advance every substep.
+		 */
+		std::vector<int> coarseTiles, fineTiles;
+		/**
+		 * A face between an active cell of a coarse tile and an active cell
+		 * of a fine tile.
+		 */
+		struct InterfaceFace
+		{
+			std::ptrdiff_t coarse, fine;
+			HeatValue conductance;
+			/**
+			 * Temperatures at the start of the multi-rate update.
+			 */
+			double coarseStart, fineStart;
+			/**
+			 * Heat that entered the fine cell through this face during the
+			 * substeps.
+			 */
+			double flux;
+		};
+		std::vector<InterfaceFace> interfaceFaces;
+		/**
+		 * Coarse cells next to fine cells, with their temperatures at the
+		 * start and at the end of the multi-rate update.  Fine substeps
+		 * read them interpolated in time.
+		 */
+		std::vector<std::ptrdiff_t> ringCells;
+		std::vector<double> ringStart, ringEnd;
+		/**
+		 * Whether the tiles must be classified again as coarse or fine.
+		 */
+		bool multirateDirty;
+		/**
+		 * Planes and time step of the tiles being updated by method {@code updateMultirateTile(int,bool)}.
+		 */
+		const HeatValue *multirateSource;
+		HeatValue *multirateTarget;
+		double multirateDeltaTime;
+#ifdef WORLDHEAT_SERIAL
+		/**
+		 * Tiles of the grid that are updated.
+		 */
+		GridTiling tiling;
+#endif
+#ifdef WORLDHEAT_DIFFUSIVITY_CLASSES
+		/**
+		 * Heat diffusivities indexed by the cells of the diffusivity plane.
+		 * Classes are added when a new diffusivity is drawn.
+		 */
+		HeatValue diffusivityClasses [HeatKernels::MAXIMUM_CLASSES];
+		/**
+		 * Number of entries of field {@code diffusivityClasses} in use.
+		 */
+		int numberClasses;
+#endif
 	public:
 		/**
 		 * Normal environmental heat used to compute heat at world borders.
@@ -86,15 +464,163 @@ namespace Enki
 		 * cells.
 		 */
 		static /*const*/ double CELL_DISSIPATION;
+		/**
+		 * Name of the heat kernel used by new instances.  See method {@code
+		 * HeatKernels::select(const std::string&)}.
+		 */
+		static std::string KERNEL;
+		/**
+		 * Number of columns of the blocks used by the temporally blocked
+		 * update.  A block and its halo should fit in the processor cache.
+		 */
+		static const int TEMPORAL_BLOCK_WIDTH;
+		/**
+		 * Name of the time integration method used by new instances,
+		 * {@code "explicit"} or {@code "adi"}.
+		 */
+		static std::string SOLVER;
+		/**
+		 * Largest rate of temperature change, in degrees per second, below
+		 * which the grid is considered in steady state and is frozen.  Zero
+		 * disables steady state detection.
+		 */
+		static /*const*/ double STEADY_STATE_THRESHOLD;
+		/**
+		 * Number of calls of method {@code computeNextState(double)} between
+		 * two steady state checks.
+		 */
+		static const int STEADY_STATE_CHECK_PERIOD;
+		/**
+		 * A heat actuator that writes a temperature that differs by more
+		 * than this value from the one it wrote when the grid was frozen
+		 * wakes up the grid.
+		 */
+		static const double FROZEN_WRITE_TOLERANCE;
+		/**
+		 * Norm of the residual of the steady state solution, relative to
+		 * the norm of the right hand side, at which the solver stops.
+		 */
+		static const double EQUILIBRIUM_TOLERANCE;
+		/**
+		 * Largest number of iterations of the steady state solver.
+		 */
+		static const int EQUILIBRIUM_ITERATIONS;
+		/**
+		 * Whether the temperature is computed as a superposition of the
+		 * step responses of the actuators while only their temperatures
+		 * change.  When the grid is in steady state, cells are only fixed
+		 * by actuators and there are no heat sources nor logs, the step
+		 * response of each actuator is computed on the grid, and the grid
+		 * is no longer updated.  Cells read by sensors are evaluated as a
+		 * sum over the recent temperature changes of the actuators, see
+		 * class {@code HeatSuperposition}.  Any other change, such as a
+		 * moving actuator, a diffusivity change or a temperature write,
+		 * writes the superposition back to the grid, which is updated
+		 * again.  Responses are kept until the diffusivity or the
+		 * actuators change.  Computing them takes as long as updating the
+		 * grid until they settle.
+		 */
+		static /*const*/ bool SUPERPOSITION;
+		/**
+		 * Largest difference between a step response and its steady state
+		 * at which the response is considered settled.
+		 */
+		static const double SUPERPOSITION_TOLERANCE;
+		/**
+		 * Longest time, in seconds, a step response is computed for.
+		 */
+		static const double SUPERPOSITION_HORIZON;
+		/**
+		 * Largest rate of temperature change, in degrees per second, at
+		 * which the grid is considered steady enough to be superposed.
+		 */
+		static const double SUPERPOSITION_STEADY_RATE;
+		/**
+		 * Spacing of the samples of a step response relative to their
+		 * age.
+		 */
+		static const double SUPERPOSITION_SAMPLE_SPACING;
+		/**
+		 * Largest error of the interpolation of a sample of a step response
+		 * between the cells where it is kept.
+		 */
+		static const double SUPERPOSITION_SAMPLE_TOLERANCE;
+		/**
+		 * Largest temperature change, in degrees per update, below which a
+		 * tile is quiescent.  A quiescent tile whose neighbours are also
+		 * quiescent is not updated.  Zero disables tile activity tracking.
+		 * The ADI and spectral solvers update every tile.
+		 */
+		static /*const*/ double ACTIVITY_THRESHOLD;
+		/**
+		 * Whether samples requested by sensors are interpolated between
+		 * the four nearest cells instead of taken from the nearest one.
+		 */
+		static /*const*/ bool BILINEAR_SAMPLING;
+		/**
+		 * Number of substeps of a multi-rate update of the explicit solver.
+		 * Calls of method {@code computeNextState(double)} are grouped by
+		 * this number.  Tiles of uniform conductance that are stable with
+		 * the grouped time step, usually air, advance once with it.  The
+		 * other tiles, with copper, actuators or sources, advance once per
+		 * call.  Heat exchanged through the faces between both kinds of
+		 * tiles is corrected so that it is conserved.  One disables
+		 * multi-rate updates.  Larger values replace temporal blocking and
+		 * disable tile activity tracking.
+		 */
+		static /*const*/ int LOCAL_TIME_STEP_RATIO;
+		/**
+		 * Scale, in centimetres, of the coarse grid of method {@code
+		 * warmUp(double)}.
+		 */
+		static /*const*/ double WARM_UP_SCALE;
+		/**
+		 * Fraction of the largest stable time step of the explicit solver
+		 * that the coarse grid of method {@code warmUp(double)} is advanced
+		 * with.
+		 */
+		static const double WARM_UP_STABILITY;
+		/**
+		 * Largest difference from the environmental temperature, in
+		 * degrees, of the cells of a tile next to a tile that heat has not
+		 * reached.  If positive, new instances store their planes sparsely:
+		 * memory is reserved for the whole grid but tiles are only
+		 * allocated, with the environmental temperature and the
+		 * diffusivity of air, when they are written by an actuator, a heat
+		 * source, a diffusivity shape or a log, or are next to a live
+		 * tile.  A tile becomes live, and is updated, when it is written or
+		 * when the heat of a live neighbour differs by more than this value
+		 * from the environmental temperature in the next update.  Cells of
+		 * unallocated tiles read the environmental temperature and air.
+		 * This suits grids of unbounded worlds with a large {@code
+		 * AbstractGrid::UNBOUNDED_MARGIN}.  Only the explicit solver without
+		 * multi-rate updates is sparse, and superposition is disabled.  The
+		 * steady state solver, whole grid logs and more substeps than the
+		 * tile side allocate every tile.  Zero disables sparse storage.
+		 */
+		static /*const*/ double SPARSE_TOLERANCE;
 	private:
 		/**
 		 * Whether method initParameters should initialize temperature or not.
 		 */
 		const bool initFlag;
 		WorldHeat (const Vector &size, const Vector &origin, double normalHeat, double gridScale, double borderSize, double concurrencyLevel, int logRate = 1);
+		/**
+		 * Create a heat model from a file in the text format written by
+		 * earlier versions.  Diffusivity is set to air.
+		 */
+		static WorldHeat *worldHeatFromTextFile (std::string filename, double concurrencyLevel, int logRate);
 		
 	public:
 		WorldHeat (const ExtendedWorld *world, double normalHeat, double gridScale, double borderSize, double concurrencyLevel, int logRate = 1);
+		/**
+		 * Create a heat model from a file written by method {@code
+		 * saveState(std::string)}.  The file is mapped in memory and its
+		 * planes copied to the grid without parsing.  Files in the old text
+		 * format are also read.  Return {@code NULL} if the file cannot be
+		 * opened, has an unsupported version, was written with the other
+		 * byte order or has a grid scale that is not positive.
+		 */
 		static WorldHeat *worldHeatFromFile (std::string filename, double concurrencyLevel, int logRate = 1);
 		virtual ~WorldHeat ();
 		/**
@@ -107,19 +633,166 @@ namespace Enki
 		 */
 		bool validParameters (double deltaTime) const;
 
+		/**
+		 * Return the name of the heat kernel used by this instance.
+		 */
+		const char *getKernelName () const
+		{
+			return HeatKernels::name (this->kernel);
+		}
+		/**
+		 * Return the name of the time integration method used by this
+		 * instance.
+		 */
+		const char *getSolverName () const
+		{
+			switch (this->solver) {
+			case ADI:
+				return "adi";
+			case SPECTRAL:
+				return "spectral";
+			default:
+				return "explicit";
+			}
+		}
+
 		double getHeatAt (const Vector &pos) const;
+		/**
+		 * Return the temperature at each of the given positions.  If
+		 * {@code bilinear} is true, temperature is interpolated between the
+		 * four nearest cells, otherwise it is the temperature of the
+		 * nearest cell, as in method {@code getHeatAt(const Vector&)}.
+		 */
+		void getHeatAt (const std::vector<Vector> &positions, std::vector<double> &values, bool bilinear) const;
+		/**
+		 * Return the temperature at the given position, interpolated if
+		 * {@code BILINEAR_SAMPLING} is set.  This is the value of a sample
+		 * requested at that position.
+		 */
+		double sampleHeatAt (const Vector &position) const;
+		/**
+		 * Request the temperature at the given position after the next
+		 * update.  Return the index of the sample.  Samples requested
+		 * during a call of method {@code computeNextState(double)} are
+		 * gathered together at the end of the call.
+		 */
+		int requestHeatSample (const Vector &position);
+		/**
+		 * Return the number of gatherings of the requested samples.
+		 */
+		int getSampleRound () const
+		{
+			return this->sampleRound;
+		}
+		/**
+		 * Get a sample requested in the given round with the given index.
+		 * Return false if it was not requested at the given position or if
+		 * it is not from the last gathering.  The sample is then out of
+		 * date and the caller should use method {@code sampleHeatAt(const
+		 * Vector&)}.
+		 */
+		bool getHeatSample (int round, int index, const Vector &position, double &value) const;
 		void setHeatAt (const Vector &pos, double value);
+		/**
+		 * Compute the cells under the given points, relative to {@code
+		 * centre}, as a sorted list of cell offsets without repetitions.
+		 * Points outside the grid are left out.  The list can be given to
+		 * method {@code setHeatAt(const std::vector<std::ptrdiff_t>&,double)}
+		 * while the grid layout does not change.
+		 */
+		void stampCells (const Vector &centre, const std::vector<Point> &points, std::vector<std::ptrdiff_t> &cells) const;
+		/**
+		 * Set the temperature of the given cells, computed by method {@code
+		 * stampCells(const Vector&,const std::vector<Point>&,std::vector<std::ptrdiff_t>&)}.
+		 */
+		void setHeatAt (const std::vector<std::ptrdiff_t> &cells, double value);
+		/**
+		 * Fix the temperature of the given cells, computed by method {@code
+		 * stampCells(const Vector&,const std::vector<Point>&,std::vector<std::ptrdiff_t>&)},
+		 * on behalf of the given owner, usually an actuator.  Fixed cells
+		 * are reset to their value after every substep, inside the grid
+		 * update, so actuators only call this method when their
+		 * temperature or position changes.  Cells previously fixed by the
+		 * same owner are released if they differ.  Cells that are not
+		 * active are ignored.
+		 */
+		void setFixedHeat (const void *owner, const std::vector<std::ptrdiff_t> &cells, double value);
+		/**
+		 * Let the cells fixed by the given owner evolve freely again.
+		 */
+		void clearFixedHeat (const void *owner);
+		/**
+		 * Add a heat source to the given cells, in degrees per second.  The
+		 * source is added after every substep.  Zero removes the source.
+		 */
+		void setHeatSource (const std::vector<std::ptrdiff_t> &cells, double rate);
 
 		double getHeatDiffusivityAt (const Point &position) const;
 		void setHeatDiffusivityAt (const Point &position, double value);
 
+		using AbstractGridProperties<HeatDiffusivity>::drawCircle;
+		using AbstractGridProperties<HeatDiffusivity>::drawPolygon;
 		/**
-		 * When a heat actuator turns off, we have to recompute the heat
-		 * distribution in the world.  We do this for a certain number of
-		 * iterations and then we start checking if we have reached a steady
-		 * state.
+		 * Draw a circle of the given heat diffusivity and wake up the grid.
+		 */
+		void drawCircle (const double &value, const Point &center, double worldRadius)
+		{
+			AbstractGridProperties<HeatDiffusivity>::drawCircle (this->toDiffusivity (value), center, worldRadius);
+			this->diffusivityChanged ();
+		}
+		/**
+		 * Draw a polygon of the given heat diffusivity and wake up the grid.
+		 */
+		void drawPolygon (const double &value, const std::vector<Point> &polygon)
+		{
+			AbstractGridProperties<HeatDiffusivity>::drawPolygon (this->toDiffusivity (value), polygon);
+			this->diffusivityChanged ();
+		}
+		/**
+		 * Tell this instance that the diffusivity plane was changed.  The
+		 * face conductances are rebuilt before the next update and the grid
+		 * is woken up.  Drawing methods of this class call this method, the
+		 * ones inherited from {@code AbstractGridProperties} do not.
+		 */
+		void diffusivityChanged ()
+		{
+			this->conductancesDirty = true;
+			this->wakeUp ();
+		}
+
+		/**
+		 * When a heat actuator changes its setpoint or turns off, we have to
+		 * recompute the heat distribution in the world.  If the grid is
+		 * frozen, it is updated again until it reaches a new steady state.
 		 */
-		virtual void computeHeatDistribution () {}
+		virtual void computeHeatDistribution ()
+		{
+			this->wakeUp ();
+		}
+		/**
+		 * Return true if the grid has reached steady state and is not being
+		 * updated.
+		 *
+		 * <p> While the grid is frozen, method {@code setHeatAt(const
+		 * Vector&,double)} does not change the temperature.  The first step
+		 * records the temperature written by actuators.  Afterwards, a
+		 * write that differs from the recorded one or that targets another
+		 * cell wakes up the grid.  The grid also wakes up when a diffusivity
+		 * shape is drawn, when the temperature is reset, and when method
+		 * {@code computeHeatDistribution()} is called.
+		 */
+		bool isFrozen () const
+		{
+			return this->frozen;
+		}
+		/**
+		 * Return true if the temperature is computed as a superposition of
+		 * actuator responses and the grid is not being updated.
+		 */
+		bool isSuperposed () const
+		{
+			return this->superposed;
+		}
 		/**
 		 * Initialise this physic interaction with the given world.
 		 */
@@ -149,37 +822,128 @@ namespace Enki
 		//  */
 		// virtual void handleObjectSense (PhysicalObject *po);
 
-		void dumpState (std::ostream &os);
+		/**
+		 * Turn on heat log.  The heat grid will be written to the given file
+		 * by a log thread, in the format given by {@code
+		 * HeatLog::FORMAT}.  Logging does not stall the simulation, frames
+		 * are dropped if the log thread falls behind.
+		 */
+		void logToStream (std::string fileName);
+		/**
+		 * Log the cells of the given rectangle, in world coordinates, every
+		 * {@code period} calls of method {@code computeNextState(double)}.
+		 * Only one of every {@code step} cells along each axis is logged.
+		 *
+		 * <p> Every log is accompanied by file {@code fileName.cells} with
+		 * the world position of each logged value, one per line.
+		 */
+		void logRectangle (const std::string &fileName, int period, int step, const Point &min, const Point &max);
+		/**
+		 * Log the cells of the given disc, such as the area around a group
+		 * of CASUs.  Cells are logged as a single row.
+		 */
+		void logDisc (const std::string &fileName, int period, int step, const Point &centre, double radius);
+		/**
+		 * Log the cells at the given positions as a single row, in the
+		 * given order.
+		 */
+		void logProbes (const std::string &fileName, int period, const std::vector<Point> &probes);
+		/**
+		 * Add a log described by the given string.  Return false and print
+		 * a message if the description is not valid.  The descriptions are:
+
+		 * <ul>
+
+		 * <li> {@code rectangle FILE PERIOD STEP XMIN YMIN XMAX YMAX}
+
+		 * <li> {@code disc FILE PERIOD STEP X Y RADIUS}
 
+		 * <li> {@code probes FILE PERIOD X Y [X Y ...]}
+
+		 * </ul>
+		 */
+		bool addLogRegion (const std::string &description);
 		/**
-		 * Turn on heat log.  The heat grid will be written to the given output
-		 * stream.
+		 * Stop and close every heat log.
 		 */
-		void logToStream (std::string fileName)
-		{
-			if (this->logStream != NULL) {
-				this->logStream->flush ();
-				delete this->logStream;
-			}
-			this->logStream = new std::ofstream (
-				fileName.c_str (),
-				std::ofstream::out | std::ofstream::trunc);
-		}
+		void turnOffLog ();
 
-		void turnOffLog ()
+		/**
+		 * Set how many calls of method {@code computeNextState(double)} are
+		 * grouped in a single update of the grid.  Each worker thread
+		 * advances its blocks that many times in cache before synchronising
+		 * with the main thread.  Heat written by actuators and read by
+		 * sensors between two updates takes effect or is refreshed only
+		 * once per update.
+		 *
+		 * <p> With the ADI solver, grouped calls are a single implicit step
+		 * with the sum of their time steps, and likewise with the spectral
+		 * solver.
+		 *
+		 * @param substeps the number of grouped calls, one disables
+		 * temporal blocking.
+		 */
+		void setTemporalBlocking (int substeps)
 		{
-			if (this->logStream != NULL) {
-				// this->logStream->close ();
-				delete this->logStream;
-			}
-			this->logStream = NULL;
+			this->temporalBlocking = std::max (1, substeps);
 		}
 
-		void saveState (std::string filename) const;
+		/**
+		 * Save grid characteristics, temperature and diffusivity to the
+		 * given file.  The file has a versioned binary header followed by
+		 * the temperature and diffusivity planes as doubles, whatever the
+		 * cell types, in the native byte order.  Return false if the file
+		 * could not be written.
+		 */
+		bool saveState (std::string filename) const;
 		/**
 		 * Reset temperature to given value.  Heat dissipation is NOT changed.
 		 */
 		void resetTemperature (double value);
+		/**
+		 * Replace the temperature by the steady state of the grid at the
+		 * start of the next update, after actuators have written their
+		 * temperatures.  The steady state is that of the explicit equation
+		 * with the current diffusivity, the cells fixed by actuators, the
+		 * heat sources and the temperature of inactive cells.  It is solved
+		 * with the conjugate gradient method preconditioned by multigrid,
+		 * see class {@code HeatMultigrid}, in a fraction of the time that
+		 * the grid takes to settle.
+		 */
+		void equilibrate ()
+		{
+			this->equilibriumRequested = true;
+		}
+		/**
+		 * Advance the grid by the given simulation time on a coarse grid
+		 * at the start of the next update, after actuators have written
+		 * their temperatures.  The temperature, diffusivity, fixed cells
+		 * and heat sources are restricted to a grid of scale {@code
+		 * WARM_UP_SCALE}, which is advanced by the explicit solver, without
+		 * multi-rate updates or superposition, with a fraction {@code
+		 * WARM_UP_STABILITY} of its largest stable time step, in whole
+		 * groups of substeps, and its temperature is interpolated back,
+		 * see method {@code resample(const WorldHeat&)}.  A coarse cell is
+		 * fixed if most of the cells it covers are, so actuators smaller
+		 * than half a coarse cell are lost.  Coarse cells over inactive
+		 * cells keep their temperature.  This skips most of the transient of a fine
+		 * grid started from ambient temperature.
+		 */
+		void warmUp (double duration)
+		{
+			this->warmUpDuration = duration;
+		}
+		/**
+		 * Replace the temperature of the active cells of this grid by that
+		 * of the given grid, which may have a different scale, size and
+		 * origin.  A cell coarser than the given grid takes the mean of
+		 * the active cells whose centres it covers, a restriction.  A finer
+		 * cell takes the bilinear interpolation of the nearest ones, a
+		 * prolongation.  Cells outside the given grid take its normal
+		 * temperature.  Diffusivity is not copied, and fixed cells keep
+		 * their temperature.
+		 */
+		void resample (const WorldHeat &source);
 	// protected:
 	// 	/**
 	// 	 * Update the heat grid and return the largest difference between two
@@ -187,10 +951,341 @@ namespace Enki
 	// 	 */
 	// 	double updateGrid (double deltaTime);
 	public:
+		/**
+		 * Advance the given tile of field {@code tiling} {@code substeps}
+		 * times.  If tile activity tracking is enabled, a tile that is not
+		 * selected for this update is copied to the next grid, the first
+		 * time it is skipped, and otherwise left untouched.
+		 */
+		void updateTile (double deltaTime, int substeps, int tile);
 		/**
 		 * Update part of the grid.
 		 */
 		void updateGrid (double deltaTime, int xmin, int ymin, int xmax, int ymax);
+		/**
+		 * Advance part of the grid {@code substeps} times and write the
+		 * result in the next grid.  The part is processed in blocks of
+		 * {@code TEMPORAL_BLOCK_WIDTH} columns.  Each block is copied
+		 * together with a halo as wide as the number of substeps to a thread
+		 * private buffer, where the substeps are computed over a shrinking
+		 * region.  The result is the same as
+		 * calling method {@code updateGrid} {@code substeps} times.
+		 */
+		void updateGridBlocked (double deltaTime, int substeps, int xmin, int ymin, int xmax, int ymax);
+		/**
+		 * First half step of the ADI solver for columns {@code [xmin,xmax)}.
+		 * The result is written in the next grid.
+		 */
+		void solveColumns (double deltaTime, int xmin, int xmax);
+		/**
+		 * Second half step of the ADI solver for rows {@code [ymin,ymax)}.
+		 * The result is written in the current grid.
+		 */
+		void solveRows (double deltaTime, int ymin, int ymax);
+		/**
+		 * Advance the given tile in a multi-rate update, from plane {@code
+		 * multirateSource} to plane {@code multirateTarget}.  Coarse tiles
+		 * advance {@code localTimeStepRatio} substeps at once.
+		 */
+		void updateMultirateTile (int tile, bool coarse);
+		/**
+		 * Advance the active cells of the given tile one explicit step from
+		 * plane {@code heat} to plane {@code next}, with the given
+		 * environmental temperature.
+		 */
+		void updateActiveTile (int tile, const HeatValue *heat, HeatValue *next, double normal);
+	private:
+		/**
+		 * Advance the grid, unless it is frozen or the substep is grouped
+		 * with the following ones.
+		 */
+		void updateHeat (double deltaTime);
+		/**
+		 * Write the temperature of the cell with the given offset, taking
+		 * frozen mode and tile activity into account.
+		 */
+		void writeHeat (std::ptrdiff_t index, double value);
+		/**
+		 * Add the given cell to the boundary list of its tile, and remove it
+		 * if it has neither a fixed temperature nor a source.
+		 */
+		void updateBoundary (std::ptrdiff_t index);
+		/**
+		 * Apply fixed temperatures and sources to the cells of the given
+		 * tiles that are inside rectangle {@code [xmin,xmax)} by {@code
+		 * [ymin,ymax)}.  The cells of plane {@code heat} are addressed with
+		 * {@code heat[(x-x0)*stride+(y-y0)]}.
+		 */
+		void applyBoundary (double deltaTime, HeatValue *heat, std::ptrdiff_t stride, int x0, int y0, int xmin, int ymin, int xmax, int ymax);
+		/**
+		 * Advance the grid with a multi-rate update of {@code
+		 * localTimeStepRatio} substeps.
+		 */
+		void updateMultirate (double deltaTime);
+		/**
+		 * Classify the tiles as coarse or fine and find the faces between
+		 * them.
+		 */
+		void classifyMultirate ();
+		/**
+		 * Run method {@code updateMultirateTile(int,bool)} for the given
+		 * tiles, in the worker threads.
+		 */
+		void runMultirate (const std::vector<int> &tiles, bool coarse);
+		/**
+		 * Return the temperature of the nearest cell, or the bilinear
+		 * interpolation of the four nearest cells, at the given position.
+		 * Positions outside the grid have the environment temperature.
+		 */
+		double interpolateHeat (const Vector &position, bool bilinear) const;
+		void updateBlock (double deltaTime, int substeps, int xmin, int ymin, int xmax, int ymax);
+		/**
+		 * Compare the grid with the snapshot taken at the start of the check
+		 * period and freeze the grid if the temperature changed slower than
+		 * {@code STEADY_STATE_THRESHOLD}.
+		 */
+		void checkSteadyState (double deltaTime);
+		/**
+		 * Leave frozen mode and restart the steady state check period.
+		 */
+		void wakeUp ();
+		/**
+		 * Solve the steady state of the grid and write it in both planes.
+		 * Return the number of iterations of the solver, or -1 if it did
+		 * not converge.
+		 */
+		int solveEquilibrium ();
+		/**
+		 * Run the warm-up requested by method {@code warmUp(double)}.
+		 */
+		void solveWarmUp ();
+		/**
+		 * Find the cells of this grid whose centres lie in the square of
+		 * the given half width around the given position, {@code
+		 * [xmin,xmax)} by {@code [ymin,ymax)}, clipped to the grid.
+		 */
+		void coveredCells (const Vector &position, double halfWidth, int &xmin, int &ymin, int &xmax, int &ymax) const;
+		/**
+		 * Solve the steady state of the unknown cells given the temperature
+		 * of the known ones, in vector {@code known} indexed by {@code
+		 * x*size.y+y}, and write it in the same vector.  The face
+		 * conductances must be computed with factor {@code partialAlpha}.
+		 * Return the number of iterations of the solver, or -1 if it did
+		 * not converge.
+		 */
+		int solveSteadyState (const std::vector<char> &unknown, std::vector<double> &known, const HeatValue *source, double normal);
+		/**
+		 * Advance the active cells of the given tiles, or of every tile if
+		 * {@code tiles} is {@code NULL}, one explicit step from plane {@code
+		 * heat} to plane {@code next}, with the given environmental
+		 * temperature, in the worker threads.  Boundary cells are not
+		 * applied.
+		 */
+		void updateActiveCells (const HeatValue *heat, HeatValue *next, double normal, const std::vector<int> *tiles);
+		/**
+		 * Superpose the grid if it is steady and only actuators fix its
+		 * cells, computing their responses if needed.
+		 */
+		void trySuperposition (double deltaTime);
+		/**
+		 * Compute the step responses of the actuators in field {@code
+		 * fixedStamps}.  A response is computed in the worker threads, on
+		 * the tiles that heat reached since the step.
+		 */
+		void computeResponses (double deltaTime);
+		/**
+		 * Write the superposition back to the grid and update the grid
+		 * again.
+		 */
+		void leaveSuperposition ();
+		/**
+		 * Return the temperature of the given cell, from the superposition
+		 * if the grid is superposed.
+		 */
+		double cellHeat (int x, int y) const
+		{
+			if (!cellAllocated (x, y)) {
+				return this->normalHeat;
+			}
+			if (!this->superposed) {
+				return this->grid [this->adtIndex][x][y];
+			}
+			// fixed cells are exact, responses are interpolated around them
+			const std::ptrdiff_t index = this->layout.index (x, y);
+			const HeatValue fixed = this->fixedHeat.data () [index];
+			return std::isnan (fixed) ? this->superposition->evaluate (index) : fixed;
+		}
+		/**
+		 * Return the diffusivity of the given cell.
+		 */
+		double cellDiffusivity (int x, int y) const
+		{
+			if (!cellAllocated (x, y)) {
+				return WorldHeat::THERMAL_DIFFUSIVITY_AIR;
+			}
+			return HeatKernels::diffusivityAt (this->prop.data (), this->layout.index (x, y), this->getDiffusivityClasses ());
+		}
+		/**
+		 * Return true if the given cell is stored in the planes, always
+		 * unless the grid is sparse.
+		 */
+		bool cellAllocated (int x, int y) const
+		{
+			return this->tileState.empty () || this->tileState [this->tiling.tileAt (x, y)] != UNALLOCATED_TILE;
+		}
+		/**
+		 * Allocate the planes of this grid and decide whether it is sparse.
+		 */
+		void initPlanes ();
+		/**
+		 * Make live the tiles of a sparse grid that cover the given
+		 * rectangle, clipped to the grid, before their cells are written.
+		 */
+		virtual void allocateCells (int xmin, int ymin, int xmax, int ymax);
+		/**
+		 * Make live the tile of the cell with the given offset in a sparse
+		 * grid.
+		 */
+		void allocateCell (std::ptrdiff_t index)
+		{
+			if (!this->tileState.empty ()) {
+				const int x = index / this->layout.stride;
+				const int y = index % this->layout.stride;
+				this->allocateCells (x, y, x + 1, y + 1);
+			}
+		}
+		/**
+		 * Allocate the given tile, if it is not, and write the
+		 * environmental temperature and the diffusivity of air in its cells.
+		 */
+		void allocateTile (int tile);
+		/**
+		 * Allocate the given tile and its neighbours and update it from now
+		 * on.
+		 */
+		void activateTile (int tile);
+		/**
+		 * Allocate every tile of a sparse grid, which becomes dense.
+		 */
+		void allocateAllTiles ();
+		/**
+		 * Return the cells stored by the given tile: its cells and the
+		 * border cells next to them.
+		 */
+		void tileCells (int tile, int &xmin, int &ymin, int &xmax, int &ymax) const;
+		/**
+		 * Return the rectangles of cells stored in the planes: the whole
+		 * grid, or the cells of the allocated tiles of a sparse grid.
+		 */
+		void storedRegions (std::vector<GridTile> &regions) const;
+		/**
+		 * Make live the tiles of a sparse grid that heat reaches in the
+		 * next update of {@code substeps} substeps: the neighbours of a live
+		 * tile whose cells that close to them differ from the
+		 * environmental temperature by more than {@code SPARSE_TOLERANCE}.
+		 */
+		void growLiveTiles (int substeps);
+		/**
+		 * Compute the face conductances with the given factor, if the
+		 * diffusivity plane or the factor changed since they were last
+		 * computed.
+		 */
+		void prepareConductances (double factor);
+		/**
+		 * Compute the east and north face conductances of the cells of
+		 * rectangle {@code [xmin,xmax)} by {@code [ymin,ymax)} with factor
+		 * {@code conductanceFactor}.
+		 */
+		void computeConductances (int xmin, int ymin, int xmax, int ymax);
+		/**
+		 * Compute the face conductances read by the update of an allocated
+		 * tile whose neighbours are allocated, and reclassify the tiles that
+		 * read them.
+		 */
+		void computeTileConductances (int tile);
+		/**
+		 * Compute field {@code tileConductance} from the conductance planes.
+		 */
+		void classifyTiles ();
+		/**
+		 * Return the conductance of every face read by the update of the
+		 * given tile, or -1 if they differ.
+		 */
+		HeatValue classifyTile (int tile) const;
+		/**
+		 * Decide which tiles are updated in this update, using the
+		 * activity of the previous update and the tiles with active cells.
+		 * Return the tiles that must be given to method {@code
+		 * updateTile(double,int,int)}, or {@code NULL} if every tile must be
+		 * updated.
+		 */
+		const std::vector<int> *selectTiles (int substeps);
+		/**
+		 * Whether the given tile changed by at least {@code
+		 * ACTIVITY_THRESHOLD} in the previous update or was written by an
+		 * actuator since.  Such a tile wakes up its neighbours.
+		 */
+		bool tileChanging (int tile) const
+		{
+			const TileActivity &a = this->activity [tile];
+			return a.written || a.maxDelta >= WorldHeat::ACTIVITY_THRESHOLD;
+		}
+		/**
+		 * Mark the tile with the given cell as written.
+		 */
+		void markWritten (int x, int y)
+		{
+			if (!this->activity.empty ()) {
+				this->activity [this->tiling.tileAt (x, y)].written = true;
+			}
+		}
+		/**
+		 * Find the tiles with active cells and allocate per tile activity
+		 * after the tiling is known.
+		 */
+		void initActivity ();
+		/**
+		 * Advance the grid with one step of the ADI solver.  Fixed cells
+		 * are boundary conditions of the line solves, heat sources are
+		 * added after the step.
+		 */
+		void updateImplicit (double deltaTime);
+		/**
+		 * Advance the grid by the given time with the spectral solver if
+		 * the active cells are the interior rectangle, the diffusivity is
+		 * uniform and no cell is fixed or has a heat source, with the ADI
+		 * solver otherwise.
+		 */
+		void updateSpectral (double deltaTime);
+		/**
+		 * Return the solver with the given name.  Unknown names select the
+		 * explicit solver.
+		 */
+		static Solver selectSolver (const std::string &name);
+		/**
+		 * Start a log of the given cells, given by their grid indexes, and
+		 * write their world positions to file {@code fileName.cells}.
+		 */
+		void startLog (const std::string &fileName, const std::vector<std::pair<int, int> > &cells, int columns, int period, int countdown);
+		/**
+		 * Return the value stored in the diffusivity plane for the given
+		 * heat diffusivity.  With diffusivity classes, a new diffusivity is
+		 * added to the table, or mapped to the closest class if the table is
+		 * full.
+		 */
+		HeatDiffusivity toDiffusivity (double value);
+		/**
+		 * Return the diffusivity table given to the heat kernels, or {@code
+		 * NULL} without diffusivity classes.
+		 */
+		const HeatValue *getDiffusivityClasses () const
+		{
+#ifdef WORLDHEAT_DIFFUSIVITY_CLASSES
+			return this->diffusivityClasses;
+#else
+			return NULL;
+#endif
+		}
 	};
 }
 
@@ -253,7 +253,11 @@ void AssisiPlayground::setDataToHeat ()
 	for (pos.x = 0; pos.x < this->dataSize.x; pos.x++) {
 		where.y = -this->world->r + this->worldHeat->gridScale;
 		for (pos.y = 0; pos.y < this->dataSize.y; pos.y++) {
-			double heat = this->worldHeat->getHeatAt (where);
+			// cells outside the arena are not simulated
+			double heat =
+				this->worldHeat->isActiveAt (where)
+				? this->worldHeat->getHeatAt (where)
+				: this->worldHeat->normalHeat;
 			//double heat = (this->worldHeat->getHeatDiffusivityAt (where) - 1.11e-4) / (1.9e-5 - 1.11e-4) * (25) + 25 ;
 			std::vector<float> &dc = this->dataColour [pos.x][pos.y];
 			heatToColour (heat, dc [0], dc [1], dc [2]);
@@ -430,9 +434,8 @@ void AssisiPlayground::keyPressEvent (QKeyEvent *event)
 		updateGL ();
 		break;
 	case Qt::Key_S:
-		qDebug () << "Saving heat state to file heat-state.txt";
-		this->worldHeat->saveState ("heat-state.txt");
-		if (false) {
+		qDebug () << "Saving heat state to file heat-state.bin";
+		if (!this->worldHeat->saveState ("heat-state.bin")) {
 			qDebug () << "Problems saving heat state!!!";
 		}
 		break;
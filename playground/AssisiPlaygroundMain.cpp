@@ -106,8 +106,12 @@ int main(int argc, char *argv[])
     string sub_address("tcp://*:5556");
 	 string heat_state_filename;
     string heat_log_file_name;
+    vector<string> heat_log_regions;
     double heat_scale;
     int heat_border_size;
+    int heat_temporal_blocking = 1;
+    bool heat_equilibrate = false;
+    double heat_warm_up = 0;
 
     double maxVibration;
     double parallelismLevel = 1.0;
@@ -147,7 +151,7 @@ int main(int argc, char *argv[])
         ("Arena.radius,r", po::value<int>(&r), 
          "playground radius, in cm")
         ("Heat.state", po::value<string>(&heat_state_filename)->default_value (""), 
-         "use heat state stored in given filename")
+         "use heat state stored in given filename, interpolated if Heat.scale differs")
 
         ("Heat.env_temp,t", po::value<double>(&env_temp), 
          "environment temperature, in C")
@@ -164,11 +168,91 @@ int main(int argc, char *argv[])
             po::value<string> (&heat_log_file_name)->default_value (""),
             "heat log file name"
             )
+        (
+            "Heat.log_region",
+            po::value<vector<string> > (&heat_log_regions),
+            "heat log of part of the grid: rectangle FILE PERIOD STEP XMIN YMIN XMAX YMAX, disc FILE PERIOD STEP X Y RADIUS or probes FILE PERIOD X Y ..."
+            )
+        (
+            "Heat.log_format",
+            po::value<string> (&HeatLog::FORMAT),
+            "heat log format: text, binary or delta"
+            )
+        (
+            "Heat.log_frames",
+            po::value<int> (&HeatLog::RING_FRAMES),
+            "heat grids buffered for the log thread before frames are dropped"
+            )
         (
             "Heat.cell_dissipation",
             po::value<double> (&WorldHeat::CELL_DISSIPATION),
             "heat lost by cells directly to outside world"
             )
+        (
+            "Heat.temporal_blocking",
+            po::value<int> (&heat_temporal_blocking),
+            "number of heat substeps computed in cache before threads synchronise"
+            )
+        (
+            "Heat.equilibrate",
+            po::value<bool> (&heat_equilibrate),
+            "start from the steady state of the heat grid with the initial actuator temperatures"
+            )
+        (
+            "Heat.warm_up",
+            po::value<double> (&heat_warm_up),
+            "simulation time, in s, that the heat grid advances on a coarse grid before the first step, zero disables"
+            )
+        (
+            "Heat.warm_up_scale",
+            po::value<double> (&WorldHeat::WARM_UP_SCALE),
+            "scale of the coarse heat grid of a warm-up, in cm"
+            )
+        (
+            "Heat.kernel",
+            po::value<string> (&WorldHeat::KERNEL),
+            "heat kernel: auto, scalar, avx2 or avx512"
+            )
+        (
+            "Heat.solver",
+            po::value<string> (&WorldHeat::SOLVER),
+            "heat time integration: explicit, adi or spectral"
+            )
+        (
+            "Heat.steady_state_threshold",
+            po::value<double> (&WorldHeat::STEADY_STATE_THRESHOLD),
+            "rate of temperature change, in C/s, below which the heat grid is frozen, zero disables"
+            )
+        (
+            "Heat.activity_threshold",
+            po::value<double> (&WorldHeat::ACTIVITY_THRESHOLD),
+            "temperature change per update, in C, below which a heat tile is quiescent, zero disables"
+            )
+        (
+            "Heat.bilinear_sampling",
+            po::value<bool> (&WorldHeat::BILINEAR_SAMPLING),
+            "interpolate the temperature measured by sensors between the four nearest heat cells"
+            )
+        (
+            "Heat.superposition",
+            po::value<bool> (&WorldHeat::SUPERPOSITION),
+            "compute the temperature as a superposition of actuator step responses while only actuator temperatures change"
+            )
+        (
+            "Heat.local_time_step_ratio",
+            po::value<int> (&WorldHeat::LOCAL_TIME_STEP_RATIO),
+            "number of time steps of the explicit solver taken at once by uniform regions of the heat grid, that other regions take one by one"
+            )
+        (
+            "Heat.sparse_tolerance",
+            po::value<double> (&WorldHeat::SPARSE_TOLERANCE),
+            "temperature difference, in C, from the environment above which an unallocated heat tile becomes live, zero disables sparse storage"
+            )
+        (
+            "Heat.unbounded_margin",
+            po::value<double> (&AbstractGrid::UNBOUNDED_MARGIN),
+            "distance, in cm, that the heat grid of a world without walls extends beyond its objects"
+            )
         (
             "AirFlow.pump_range",
             po::value<double> (&Casu::AIR_PUMP_RANGE),
@@ -223,6 +307,21 @@ int main(int argc, char *argv[])
             po::value<double> (&parallelismLevel),
             "Percentage of CPU threads to use"
             )
+        (
+            "Simulation.tile_width",
+            po::value<int> (&GridTiling::TILE_WIDTH),
+            "number of grid columns in a tile updated by a worker thread"
+            )
+        (
+            "Simulation.tile_height",
+            po::value<int> (&GridTiling::TILE_HEIGHT),
+            "number of grid rows in a tile updated by a worker thread"
+            )
+        (
+            "Simulation.worker_cpus",
+            po::value<string> (&WorkerPool::WORKER_CPUS),
+            "processors where worker threads are pinned, such as 0-7,16-23"
+            )
         (
             "Bee.body_length",
             po::value<double> (&bee_body_length),
@@ -318,17 +417,38 @@ int main(int argc, char *argv[])
     if (heat_state_filename != "" && vm.count ("Heat.state")) {
        if (vm.count ("Heat.env_temp"))
           cout << "Discarding parameter Heat.env_temp\n";
-       if (vm.count ("Heat.scale"))
-          cout << "Discarding parameter Heat.scale\n";
-       if (vm.count ("Heat.border_size"))
-          cout << "Discarding parameter Heat.border_size\n";
        heatModel = WorldHeat::worldHeatFromFile (heat_state_filename, parallelismLevel);
+       if (heatModel == NULL)
+          return 1;
+       if (vm.count ("Heat.scale") && heat_scale != heatModel->gridScale) {
+          // a state saved at another scale is interpolated on a new grid
+          WorldHeat *saved = heatModel;
+          heatModel = new WorldHeat (world, saved->normalHeat, heat_scale, heat_border_size, parallelismLevel);
+          heatModel->resample (*saved);
+          cout << "Resampled heat state from scale " << saved->gridScale << " to scale " << heat_scale << "\n";
+          delete saved;
+       }
+       else if (vm.count ("Heat.border_size"))
+          cout << "Discarding parameter Heat.border_size\n";
     }
     else
        heatModel = new WorldHeat (world, env_temp, heat_scale, heat_border_size, parallelismLevel);
+	cout << "Using " << heatModel->getKernelName () << " heat kernel and " << heatModel->getSolverName () << " heat solver\n";
+	heatModel->setTemporalBlocking (heat_temporal_blocking);
+	if (heat_equilibrate) {
+		heatModel->equilibrate ();
+	}
+	if (heat_warm_up > 0) {
+		heatModel->warmUp (heat_warm_up);
+	}
 	if (heat_log_file_name != "") {
 		heatModel->logToStream (heat_log_file_name);
 	}
+	for (vector<string>::const_iterator region = heat_log_regions.begin (); region != heat_log_regions.end (); region++) {
+		if (!heatModel->addLogRegion (*region)) {
+			return 1;
+		}
+	}
 	world->addPhysicSimulation(heatModel);
 	CasuHandler *ch = new CasuHandler();
 	world->addHandler("Casu", ch);
@@ -0,0 +1,56 @@
+/* Test that the heat solvers reach the steady state of the explicit solver
+ * around a fixed temperature cell.
+
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "extensions/ExtendedWorld.h"
+#include "interactions/WorldHeat.h"
+
+using namespace Enki;
+
+/**
+ * Temperature of the neighbour of a 40 C cell in the middle of a square
+ * arena of 25 C air after {@code duration} seconds of steps of {@code
+ * deltaTime} seconds.
+ */
+static double neighbourHeat (const std::string &solver, double deltaTime, double duration)
+{
+	WorldHeat::SOLVER = solver;
+	ExtendedWorld world (20.0, 20.0);
+	WorldHeat *heat = new WorldHeat (&world, 25, 0.5, 2, 1.0);
+	world.addPhysicSimulation (heat);
+	std::vector<Point> points (1, Point (0, 0));
+	std::vector<std::ptrdiff_t> cells;
+	heat->stampCells (Point (10, 10), points, cells);
+	heat->computeNextState (deltaTime);
+	heat->setFixedHeat (&cells, cells, 40);
+	for (int i = 0; i < duration / deltaTime + 0.5; i++) {
+		heat->computeNextState (deltaTime);
+	}
+	const double result = heat->getHeatAt (Point (10.5, 10));
+	delete heat;
+	return result;
+}
+
+int main (int argc, char *argv[])
+{
+	const double expected = neighbourHeat ("explicit", 0.1, 2000);
+	const double deltaTimes [] = {1, 10, 60};
+	int failures = 0;
+	const char *solvers [] = {"adi", "spectral"};
+	for (int j = 0; j < 2; j++) {
+		for (int i = 0; i < 3; i++) {
+			const double value = neighbourHeat (solvers [j], deltaTimes [i], 20000);
+			const bool passed = fabs (value - expected) < 1e-3;
+			printf ("%s %s dt=%g: %.4f C, explicit %.4f C\n", passed ? "ok" : "FAILED", solvers [j], deltaTimes [i], value, expected);
+			failures += passed ? 0 : 1;
+		}
+	}
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
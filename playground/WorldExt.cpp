@@ -200,6 +200,36 @@ namespace Enki
                  iterator++;
               }
            }
+           else if (command == "equilibrate")
+           {
+              PhysicSimulationsIterator iterator = this->physicSimulations.begin ();
+              PhysicSimulationsIterator end = this->physicSimulations.end ();
+              while (iterator != end) {
+                 WorldHeat *worldHeat = dynamic_cast<WorldHeat *> (*iterator);
+                 if (worldHeat != NULL) {
+                    worldHeat->equilibrate ();
+                 }
+                 iterator++;
+              }
+           }
+           else if (command == "warm_up")
+           {
+              Time duration_msg;
+              assert (duration_msg.ParseFromString (data));
+              PhysicSimulationsIterator iterator = this->physicSimulations.begin ();
+              PhysicSimulationsIterator end = this->physicSimulations.end ();
+              while (iterator != end) {
+                 WorldHeat *worldHeat = dynamic_cast<WorldHeat *> (*iterator);
+                 if (worldHeat != NULL) {
+                    worldHeat->warmUp (duration_msg.sec () + 1e-9 * duration_msg.nsec ());
+                 }
+                 iterator++;
+              }
+           }
+           else
+           {
+              cerr << "Unknown heat command " << command << endl;
+           }
         }
         else
         {